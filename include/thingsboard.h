@@ -6,10 +6,15 @@
 #include <time.h>
 
 #include <zephyr/net/tls_credentials.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/sys/util.h>
 
 #ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
 #include <thingsboard_attributes_serde.h>
 #include <thingsboard_telemetry_serde.h>
+#ifdef CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES
+#include <thingsboard_client_attributes_serde.h>
+#endif /* CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES */
 #else /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
 #include <thingsboard.pb.h>
 #endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
@@ -50,6 +55,10 @@ typedef struct thingsboard_attributes thingsboard_attributes;
 
 typedef struct thingsboard_telemetry thingsboard_telemetry;
 
+#ifdef CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES
+typedef struct thingsboard_client_attributes thingsboard_client_attributes;
+#endif /* CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES */
+
 /**
  * One timeseries element. Used to attach a timestamp to a `thingsboard_telemetry` object.
  */
@@ -58,7 +67,51 @@ typedef struct thingsboard_timeseries {
 	bool has_values;
 	thingsboard_telemetry values;
 } thingsboard_timeseries;
-#endif
+#else /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+/* The JSON code gen provides the same enum in `thingsboard_attributes_serde.h` */
+#define THINGSBOARD_ATTRIBUTES_FIELD_ENUM(_, __, ___, ____, _fieldname, _____)                      \
+	THINGSBOARD_ATTRIBUTES_FIELD_##_fieldname,
+
+enum thingsboard_attributes_field {
+	thingsboard_attributes_FIELDLIST(THINGSBOARD_ATTRIBUTES_FIELD_ENUM, NULL)
+	THINGSBOARD_ATTRIBUTES_FIELD_COUNT,
+};
+
+#define THINGSBOARD_ATTRIBUTES_MASK_WORDS DIV_ROUND_UP(THINGSBOARD_ATTRIBUTES_FIELD_COUNT, 32)
+
+#ifdef CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES
+#define THINGSBOARD_CLIENT_ATTRIBUTES_FIELD_ENUM(_, __, ___, ____, _fieldname, _____)               \
+	THINGSBOARD_CLIENT_ATTRIBUTES_FIELD_##_fieldname,
+
+enum thingsboard_client_attributes_field {
+	thingsboard_client_attributes_FIELDLIST(THINGSBOARD_CLIENT_ATTRIBUTES_FIELD_ENUM, NULL)
+	THINGSBOARD_CLIENT_ATTRIBUTES_FIELD_COUNT,
+};
+
+/* At least one word, like the JSON code gen, as the message might have no fields */
+#define THINGSBOARD_CLIENT_ATTRIBUTES_MASK_WORDS                                                   \
+	MAX(DIV_ROUND_UP(THINGSBOARD_CLIENT_ATTRIBUTES_FIELD_COUNT, 32), 1)
+#endif /* CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES */
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+/**
+ * Mark `field` in a mask of `THINGSBOARD_ATTRIBUTES_MASK_WORDS` words.
+ */
+static inline void thingsboard_attributes_mask_set(uint32_t *mask,
+						   enum thingsboard_attributes_field field)
+{
+	mask[field / 32] |= BIT(field % 32);
+}
+
+/**
+ * Check whether `field` is marked in a mask of `THINGSBOARD_ATTRIBUTES_MASK_WORDS` words.
+ */
+static inline bool thingsboard_attributes_mask_test(const uint32_t *mask,
+						    enum thingsboard_attributes_field field)
+{
+	return (mask[field / 32] & BIT(field % 32)) != 0;
+}
 
 /**
  * This callback will be called when new shared attributes are
@@ -68,6 +121,49 @@ typedef struct thingsboard_timeseries {
  */
 typedef void (*thingsboard_attributes_write_callback_t)(thingsboard_attributes *attr);
 
+/**
+ * This callback will be called, when shared attributes a subscription is
+ * interested in changed their value.
+ *
+ * @param attributes Current state of the shared attributes
+ * @param changed Mask of all fields which changed or were deleted, use
+ *                `thingsboard_attributes_mask_test()` to check for a field
+ * @param user_data User data given in the subscription
+ */
+typedef void (*thingsboard_attributes_changed_callback_t)(const thingsboard_attributes *attributes,
+							  const uint32_t *changed,
+							  void *user_data);
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_FETCH
+/**
+ * This callback will be called, when fetching attributes completed.
+ *
+ * It is called from the CoAP client thread, after the fetched attributes have
+ * been applied. The Thingsboard lock is not held, so the callback may call
+ * other functions of this library, e.g. to start the next fetch.
+ *
+ * @param err 0 on success, negative on error
+ * @param attributes Attributes contained in the response, NULL on error
+ * @param user_data User data given to `thingsboard_fetch_attributes()`
+ */
+typedef void (*thingsboard_attributes_fetch_callback_t)(int err,
+							const thingsboard_attributes *attributes,
+							void *user_data);
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_FETCH */
+
+/**
+ * Subscription to changes of individual shared attributes, see
+ * `thingsboard_attributes_subscribe()`.
+ */
+struct thingsboard_attributes_subscription {
+	/** Fields to be notified about, set with `thingsboard_attributes_mask_set()` */
+	uint32_t fields[THINGSBOARD_ATTRIBUTES_MASK_WORDS];
+	thingsboard_attributes_changed_callback_t cb;
+	void *user_data;
+	/** Internal, do not touch */
+	sys_snode_t node;
+};
+
 /**
  * This callback will be called on events generated by the Thingsboard client
  * library.
@@ -75,6 +171,32 @@ typedef void (*thingsboard_attributes_write_callback_t)(thingsboard_attributes *
  */
 typedef void (*thingsboard_event_callback_t)(enum thingsboard_event ev);
 
+/**
+ * Outcome of one telemetry message, reported to `thingsboard_delivery_callback_t`.
+ */
+struct thingsboard_delivery_status {
+	/** 0 if a response has been received, negative error code of the
+	 * CoAP client otherwise, e.g. -ETIMEDOUT */
+	int err;
+	/** CoAP response code, e.g. `COAP_RESPONSE_CODE_CREATED`. 0 without response. */
+	uint8_t code;
+	/** Class of `code`: 2 on success, 4 if rejected, 5 on server errors */
+	uint8_t code_class;
+	/** Time from sending the request until completion in milliseconds,
+	 * including retransmissions */
+	uint32_t rtt_ms;
+	/** Number of timeseries entries carried by the message */
+	size_t ts_count;
+};
+
+/**
+ * This callback will be called, when a telemetry message sent with a
+ * delivery callback has been completed. It is called from the CoAP client
+ * thread, so it should return quickly.
+ */
+typedef void (*thingsboard_delivery_callback_t)(const struct thingsboard_delivery_status *status,
+						void *user_data);
+
 struct thingsboard_firmware_info {
 	/** Title of your firmware, e.g. <project>-prod. This
 	 * must match to what you configure on your thingsboard
@@ -98,8 +220,9 @@ struct thingsboard_callbacks {
 	/**
 	 * Callback being called on attribute updates.
 	 *
-	 * The Thingsboard SDK does not track the attributes and does not handle
-	 * deletion of attributes.
+	 * Only receives the attributes contained in the notification. Deleted
+	 * attributes are reported to subscriptions, see
+	 * `thingsboard_attributes_subscribe()`.
 	 */
 	thingsboard_attributes_write_callback_t on_attributes_write;
 
@@ -169,6 +292,24 @@ struct thingsboard_configuration {
 	 * Callbacks from Thingsboard SDK to application.
 	 */
 	struct thingsboard_callbacks callbacks;
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_FETCH
+	/**
+	 * Shared attributes to be fetched when connecting, see
+	 * `thingsboard_fetch_attributes()`. If set, attribute notifications are
+	 * not observed when connecting, as the initial response of the
+	 * observation contains all shared attributes again. Call
+	 * `thingsboard_observe_attributes()` to receive notifications. NULL to
+	 * observe right away.
+	 */
+	const uint32_t *fetch_attributes;
+
+	/**
+	 * Optional, called when fetching `fetch_attributes` completed, with
+	 * `user_data` set to NULL.
+	 */
+	thingsboard_attributes_fetch_callback_t fetch_callback;
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_FETCH */
 };
 
 #ifdef CONFIG_THINGSBOARD_TIME
@@ -185,9 +326,10 @@ time_t thingsboard_time(void);
 
 /**
  * Same as thingsboard_time, but the return value is not truncated to
- * seconds. Please be aware that no special care is taken to guarantee
- * the accuracy of the time. Due to network latency, the time will
- * be off in the order of multiple seconds.
+ * seconds. The received time is compensated for half the round trip time
+ * of the request, and the drift of the local clock, estimated across time
+ * updates, is taken into account. Still, asymmetric network latency can
+ * cause an error of up to half of `CONFIG_THINGSBOARD_TIME_MAX_RTT_MS`.
  *
  * @return Current time in milliseconds.
  */
@@ -204,6 +346,8 @@ int64_t thingsboard_time_msec(void);
  * @param payload Pointer to byte array to be send to Thingsboard.
  * @param sz Length of `payload` in bytes
  *
+ * @retval -EINVAL `sz` exceeds `CONFIG_COAP_CLIENT_MESSAGE_SIZE`, see
+ *         `thingsboard_send_telemetry_blockwise()` for larger messages
  * @return 0 on success, negative on error
  */
 int thingsboard_send_telemetry_buf(const void *payload, size_t sz);
@@ -212,6 +356,9 @@ int thingsboard_send_telemetry_buf(const void *payload, size_t sz);
  * Serialize and send telemetry without timestamp.
  * See https://thingsboard.io/docs/user-guide/telemetry/ for details.
  *
+ * With `CONFIG_THINGSBOARD_TELEMETRY_QUEUE` enabled, the telemetry is queued
+ * when it can not be sent right now. See `thingsboard_send_timeseries()`.
+ *
  * @param telemetry Pointer of `thingsboard_telemetry` object to be send
  *
  * @return 0 on success, negative on error
@@ -229,13 +376,213 @@ int thingsboard_send_telemetry(const thingsboard_telemetry *telemetry);
  *
  * See https://thingsboard.io/docs/user-guide/telemetry/ for details.
  *
+ * With `CONFIG_THINGSBOARD_TELEMETRY_QUEUE` enabled, data is put into a RAM
+ * queue, when the client is not connected or there are not enough free
+ * requests. The queue is sent as soon as the client becomes active again.
+ *
  * @param ts array of `thingsboard_timeseries` to be send to Thingsboard
  * @param ts_count amount of `thingsboard_timeseries` objects in `ts`
  *
+ * @retval -EAGAIN Not connected and `CONFIG_THINGSBOARD_TELEMETRY_QUEUE` disabled
+ * @retval -ENOSPC Queue full, data has been dropped (only with
+ *                 `CONFIG_THINGSBOARD_TELEMETRY_QUEUE_DROP_NEWEST`)
  * @return 0 on success, negative on error
  */
 int thingsboard_send_timeseries(const thingsboard_timeseries *ts, size_t ts_count);
 
+/**
+ * Same as `thingsboard_send_telemetry()`, but reports the outcome to `cb`.
+ *
+ * See `thingsboard_send_timeseries_cb()`.
+ *
+ * @param telemetry Pointer of `thingsboard_telemetry` object to be send
+ * @param cb Callback, called once the message has been completed
+ * @param user_data Passed to `cb`
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_send_telemetry_cb(const thingsboard_telemetry *telemetry,
+				  thingsboard_delivery_callback_t cb, void *user_data);
+
+/**
+ * Same as `thingsboard_send_timeseries()`, but reports the outcome of every
+ * message to `cb`. If the data needs multiple messages, `cb` is called
+ * once for each of them, see `thingsboard_delivery_status.ts_count`.
+ *
+ * `cb` is called for every message that has been sent. If this function
+ * returned 0, these are all of them. On -EIO, the messages sent before the
+ * failure are still reported to `cb`, the remaining data has not been sent.
+ * Messages carry the leading entries of `ts`, so the sum of their
+ * `thingsboard_delivery_status.ts_count` is the index of the first entry
+ * that has not been sent. On all other errors, `cb` is not called at all.
+ * The data is never queued, the application is expected to handle retries
+ * itself.
+ *
+ * @param ts array of `thingsboard_timeseries` to be send to Thingsboard
+ * @param ts_count amount of `thingsboard_timeseries` objects in `ts`
+ * @param cb Callback, called once per message
+ * @param user_data Passed to `cb`
+ *
+ * @retval -EAGAIN Not connected
+ * @retval -ENOMEM Not enough free requests to send all data
+ * @retval -EIO Sending failed, possibly after some messages have been sent
+ * @return 0 on success, negative on error
+ */
+int thingsboard_send_timeseries_cb(const thingsboard_timeseries *ts, size_t ts_count,
+				   thingsboard_delivery_callback_t cb, void *user_data);
+
+#ifdef CONFIG_THINGSBOARD_TIMESERIES_STREAM
+/**
+ * Source of timeseries entries for `thingsboard_send_timeseries_stream()`.
+ *
+ * The callbacks are called from the system work queue.
+ */
+struct thingsboard_timeseries_source {
+	/** Copy up to `max` entries, starting `offset` entries after the
+	 * current position, into `ts`, without advancing the position. The
+	 * entries before `offset` are still in flight. Strings referenced by
+	 * the entries only need to stay valid until the next call of `peek` or
+	 * `consume`. Returns the number of entries, 0 at the end of the data,
+	 * negative on error. */
+	int (*peek)(size_t offset, thingsboard_timeseries *ts, size_t max, void *user_data);
+	/** Advance the position by `count` entries, they have been
+	 * acknowledged by Thingsboard and can be deleted. */
+	void (*consume)(size_t count, void *user_data);
+	/** Optional, called once when all entries have been acknowledged (0),
+	 * or when the stream stopped because of an error. Entries not consumed
+	 * by then have not been acknowledged. */
+	void (*done)(int err, void *user_data);
+	void *user_data;
+};
+
+/**
+ * Send timeseries of arbitrary length, e.g. a backlog stored in flash.
+ *
+ * In contrast to `thingsboard_send_timeseries()`, messages are encoded one
+ * at a time, when a previous one has been completed, keeping up to
+ * `CONFIG_THINGSBOARD_TIMESERIES_STREAM_WINDOW` messages in flight. Only
+ * one stream can be active at a time.
+ *
+ * Entries are only consumed from the source, once the message carrying them
+ * has been acknowledged with a 2.xx code, in the order they have been sent.
+ * The stream stops on the first message, that is not acknowledged, or if the
+ * client becomes inactive. All entries left in the source then can be sent
+ * again with a new stream. Some of them might have been delivered by a later
+ * message still, so they are sent twice.
+ *
+ * @param source Source of the entries, must stay valid until `done` is called
+ *
+ * @retval -EAGAIN Not connected
+ * @retval -EBUSY Another stream is active
+ * @return 0 on success, negative on error
+ */
+int thingsboard_send_timeseries_stream(const struct thingsboard_timeseries_source *source);
+#endif /* CONFIG_THINGSBOARD_TIMESERIES_STREAM */
+
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BLOCKWISE
+/**
+ * Source of an encoded telemetry message for `thingsboard_send_telemetry_blockwise()`.
+ *
+ * The callbacks are called from the system work queue.
+ */
+struct thingsboard_telemetry_source {
+	/** Copy `len` bytes of the message, starting at `offset`, into `buf`.
+	 * Blocks are read in order, each one once, unless the upload fails.
+	 * Returns the number of bytes copied, which has to be `len`, or
+	 * negative on error. */
+	int (*read)(size_t offset, void *buf, size_t len, void *user_data);
+	/** Optional, called once when the message has been acknowledged (0),
+	 * or when the upload stopped because of an error. */
+	void (*done)(int err, void *user_data);
+	/** Total size of the message in bytes */
+	size_t size;
+	void *user_data;
+};
+
+/**
+ * Send a single telemetry message, which might be larger than a CoAP
+ * message, e.g. a waveform snapshot stored in flash.
+ *
+ * The message is uploaded block-wise (RFC 7959), reading one block of
+ * `CONFIG_THINGSBOARD_TELEMETRY_BLOCKWISE_BLOCK_SIZE` bytes at a time from
+ * `source`, so it never has to be copied to RAM as a whole. The message has
+ * to be encoded like the payload of `thingsboard_send_telemetry_buf()`. Only
+ * one upload can be active at a time.
+ *
+ * The upload stops on the first block, that is not acknowledged, or if the
+ * client becomes inactive. If the server rejects the block size with 4.13,
+ * `done` is called with -EMSGSIZE.
+ *
+ * @param source Source of the message, must stay valid until `done` is called
+ *
+ * @retval -EINVAL Empty message or too many blocks
+ * @retval -EAGAIN Not connected
+ * @retval -EBUSY Another upload is active
+ * @return 0 on success, negative on error
+ */
+int thingsboard_send_telemetry_blockwise(const struct thingsboard_telemetry_source *source);
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BLOCKWISE */
+
+/**
+ * Same as `thingsboard_send_telemetry()`, but sent as non-confirmable CoAP
+ * message.
+ *
+ * See `thingsboard_send_timeseries_non_confirmable()`.
+ *
+ * @param telemetry Pointer of `thingsboard_telemetry` object to be send
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_send_telemetry_non_confirmable(const thingsboard_telemetry *telemetry);
+
+/**
+ * Same as `thingsboard_send_timeseries()`, but sent as non-confirmable CoAP
+ * messages, for data that may get lost.
+ *
+ * The messages are neither acknowledged nor retransmitted. The CoAP client
+ * still reads the payload for block-wise transfers and waits for a possible
+ * response, so the requests are released once it answered or the CoAP client
+ * gave up on it. The data is never queued.
+ *
+ * @param ts array of `thingsboard_timeseries` to be send to Thingsboard
+ * @param ts_count amount of `thingsboard_timeseries` objects in `ts`
+ *
+ * @retval -EAGAIN Not connected
+ * @retval -ENOMEM Not enough free requests to send all data
+ * @return 0 on success, negative on error
+ */
+int thingsboard_send_timeseries_non_confirmable(const thingsboard_timeseries *ts, size_t ts_count);
+
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR
+/**
+ * Record telemetry, timestamped with `thingsboard_time_msec()`, to be sent
+ * together with other samples.
+ *
+ * Recorded samples are sent as one timeseries message with
+ * `thingsboard_send_timeseries()`, as soon as the encoded batch reaches
+ * `CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR_FLUSH_PERCENT` of the message size,
+ * `CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR_MAX_ENTRIES` samples are recorded,
+ * or the first sample is older than
+ * `CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR_MAX_LATENCY_MS`.
+ *
+ * Samples of a batch that fails to be sent are dropped. Enable
+ * `CONFIG_THINGSBOARD_TELEMETRY_QUEUE` to keep them while not connected.
+ *
+ * @param telemetry Pointer of `thingsboard_telemetry` object to be recorded
+ *
+ * @return 0 on success, negative on error, including errors of sending a
+ *         batch that has been completed by this sample
+ */
+int thingsboard_record_telemetry(const thingsboard_telemetry *telemetry);
+
+/**
+ * Send all telemetry recorded with `thingsboard_record_telemetry()` now.
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_flush_telemetry(void);
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR */
+
 /**
  * Lock Thingsboard SDKs internal lock.
  */
@@ -296,6 +643,154 @@ int thingsboard_resume(void);
  */
 const thingsboard_attributes *thingsboard_get_attributes(void);
 
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF
+/**
+ * Metadata of the last update of a shared attribute, as sent by Thingsboard.
+ */
+struct thingsboard_attribute_meta {
+	/** Server timestamp of the update in milliseconds, 0 if unknown */
+	int64_t ts;
+	/** Version of the attribute, only valid if `has_version` is set */
+	int64_t version;
+	bool has_version;
+};
+
+/**
+ * Get the metadata of the last update of a shared attribute.
+ *
+ * Updates, which are not newer than the last one by version, or by timestamp
+ * if there is no version, are ignored. This avoids re-applying identical
+ * attributes after re-subscribing.
+ *
+ * Only available with Protobuf, the JSON format carries no metadata.
+ *
+ * @param field Attribute to get the metadata for
+ * @param meta Where to store the metadata, all zero if no update has been received
+ *
+ * @retval -EINVAL Invalid field
+ * @retval 0 Success
+ */
+int thingsboard_get_attribute_meta(enum thingsboard_attributes_field field,
+				   struct thingsboard_attribute_meta *meta);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF */
+
+/**
+ * Subscribe to changes of individual shared attributes.
+ *
+ * The callback of the subscription is called with the Thingsboard internal
+ * lock held, whenever an attribute notification changed the value of any of
+ * the fields in `subscription->fields`. Attributes received with their
+ * current value do not cause a call.
+ *
+ * @param subscription Subscription, must stay valid until unsubscribed
+ *
+ * @retval -EALREADY Already subscribed
+ * @retval 0 Success
+ */
+int thingsboard_attributes_subscribe(struct thingsboard_attributes_subscription *subscription);
+
+/**
+ * Remove a subscription added with `thingsboard_attributes_subscribe()`.
+ *
+ * @param subscription Subscription to be removed
+ *
+ * @retval -ENOENT Not subscribed
+ * @retval 0 Success
+ */
+int thingsboard_attributes_unsubscribe(struct thingsboard_attributes_subscription *subscription);
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_SNAPSHOT
+/**
+ * Copy of the shared attributes, including the strings they reference.
+ */
+struct thingsboard_attributes_snapshot {
+	thingsboard_attributes attributes;
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	struct thingsboard_attributes_buffer buffer;
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+};
+
+/**
+ * Copy the current state of shared attributes.
+ *
+ * In contrast to `thingsboard_get_attributes()`, this does not require the
+ * Thingsboard internal lock and never blocks on network processing, so it may
+ * be called at high rates. The copy is consistent, i.e. it reflects the
+ * attributes after a complete update.
+ *
+ * @param snapshot Where to store the copy
+ */
+void thingsboard_get_attributes_snapshot(struct thingsboard_attributes_snapshot *snapshot);
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_SNAPSHOT */
+
+#ifdef CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES
+/**
+ * Publish client side attributes.
+ *
+ * Attributes set in `attributes` are merged with the ones set before, and
+ * sent in one message `CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES_DELAY_MS` after
+ * the first change. Only attributes differing from the last values
+ * acknowledged by Thingsboard are sent. Failed uploads are retried after
+ * `CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES_RETRY_INTERVAL_MS`.
+ *
+ * @param attributes Attributes to be published, all strings are copied
+ *
+ * @retval -ENOMEM A string attribute is too long
+ * @retval 0 Success
+ */
+int thingsboard_set_client_attributes(const thingsboard_client_attributes *attributes);
+
+/**
+ * Send pending client side attributes right away.
+ *
+ * @retval -EAGAIN Not connected
+ * @retval -EBUSY An upload is in progress, the pending attributes are sent
+ *                once it completed
+ * @retval 0 Attributes sent or nothing to send
+ */
+int thingsboard_flush_client_attributes(void);
+#endif /* CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES */
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_FETCH
+/**
+ * Request selected shared attributes once.
+ *
+ * Only the given attributes are transferred, in contrast to the initial
+ * response of the attribute observation, which contains all of them. The
+ * received attributes are applied like attribute notifications, i.e.
+ * subscriptions and `on_attributes_write` are called. Only shared attributes
+ * can be fetched, client side attributes are published by the device itself.
+ *
+ * Responses need to fit into a single CoAP message.
+ *
+ * @param fields Mask of the attributes to be fetched, set with
+ *               `thingsboard_attributes_mask_set()`
+ * @param cb Called when the fetch completed, may be NULL
+ * @param user_data Passed to `cb`
+ *
+ * @retval -EAGAIN Not connected
+ * @retval -EBUSY Another fetch is in progress
+ * @retval -EINVAL No attribute given
+ * @retval -ENOMEM Keys do not fit into `CONFIG_THINGSBOARD_ATTRIBUTES_FETCH_MAX_PATH_LENGTH`
+ * @retval 0 Request sent
+ */
+int thingsboard_fetch_attributes(const uint32_t *fields, thingsboard_attributes_fetch_callback_t cb,
+				 void *user_data);
+
+/**
+ * Observe attribute notifications, when `fetch_attributes` in the
+ * configuration skipped this when connecting.
+ *
+ * The initial response of the observation contains all shared attributes, so
+ * devices only waking up briefly might not need it at all.
+ *
+ * @retval -EAGAIN Not connected
+ * @retval -EALREADY Already observing attribute notifications
+ * @return 0 on success, negative on error
+ */
+int thingsboard_observe_attributes(void);
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_FETCH */
+
 /**
  * Initialize the Thingsboard library.
  *
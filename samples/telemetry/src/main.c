@@ -58,16 +58,12 @@ int main(void)
 static int cmd_send_uptime(const struct shell *shell, size_t argc, char **argv)
 {
 	int err;
-	char payload[32];
-	int64_t uptime = k_uptime_seconds();
+	thingsboard_telemetry telemetry = {
+		.has_uptime = true,
+		.uptime = k_uptime_seconds(),
+	};
 
-	err = snprintk(payload, sizeof(payload), "{\"uptime\":%lld}", uptime);
-	if (err < 0) {
-		LOG_ERR("Could not format payload, error (%d): %s", err, strerror(-err));
-		return err;
-	}
-
-	err = thingsboard_send_telemetry_buf(payload, strlen(payload));
+	err = thingsboard_send_telemetry(&telemetry);
 	if (err) {
 		LOG_ERR("Could not send telemetry, error (%d): %s", err, strerror(-err));
 		return err;
@@ -19,6 +19,13 @@
 #   struct declarations don't really cost anything - except for the parser descriptors.
 # - Currently, no attempt is made to escape any names. Hence, all field names must be
 #   valid C identifiers.
+# - Supported types are string, boolean, number/integer (int32_t), integer with
+#   "format": "int64" (int64_t), number with "format": "double" (double) and arrays
+#   of those with "maxItems", which become fixed size arrays with a _len member.
+# - Strings with "maxLength" get a buffer of exactly that size (plus terminator) in
+#   the _buffer struct, all others use the size given by --string-buffer-size.
+#   With --cmake-sizes, only these sizes are written, as CMake variables named
+#   <schema>_<member>_max_size, e.g. to size the same strings in nanopb options.
 # - The name of all identifiers is derived from the filename (w/o extension) of the
 #   first supplied JSON schema.
 
@@ -26,6 +33,7 @@ import click
 import json_ref_dict as jrd
 import sys
 import os
+import zlib
 
 
 class Property:
@@ -47,12 +55,35 @@ class Property:
     def make_copy(self, src, dst, buf):
         raise NotImplementedError()
 
+    def make_differs(self, src, dst):
+        """C expression, true if the member in `src` holds another value than in `dst`"""
+        raise NotImplementedError()
+
     def make_str_buffer(self, string_buffer_size):
         raise NotImplementedError()
 
+    def make_encode(self, value):
+        raise NotImplementedError()
+
+    def encode_helpers(self):
+        """Names of the helper functions needed by `make_encode()`"""
+        return set()
+
+    def needs_buffer(self):
+        """Whether the member references strings, which need a buffer to be copied"""
+        return False
+
     def make_buffer(self, string_buffer_size):
         raise NotImplementedError()
 
+    def make_rebase(self, value, buf):
+        """Point the strings of the member at their copies in `buf`"""
+        raise NotImplementedError()
+
+    def make_clear(self, value, buf):
+        """Reset the member and its copy in `buf`"""
+        raise NotImplementedError()
+
     def root_property(self):
         if not self.parent:
             return self
@@ -72,8 +103,16 @@ class Property:
             klass = ObjectProperty
         elif type == "string":
             klass = StringProperty
-        elif type == "number":
+        elif type == "boolean":
+            klass = BooleanProperty
+        elif type == "integer" and schema.get("format") == "int64":
+            klass = Int64Property
+        elif type == "number" and schema.get("format") == "double":
+            klass = DoubleProperty
+        elif type in ("number", "integer"):
             klass = NumberProperty
+        elif type == "array":
+            klass = ArrayProperty
         else:
             raise TypeError(f"Type {type} not supported")
         return klass(name, schema)
@@ -101,6 +140,15 @@ class ObjectProperty(Property):
     def make_member(self):
         return f"struct {self.name} {self._name};"
 
+    def make_encode(self, value):
+        return make_object_encode(self, value, optional=False)
+
+    def encode_helpers(self):
+        helpers = set()
+        for p in self.properties:
+            helpers |= p.encode_helpers()
+        return helpers
+
     def add_property(self, prop):
         self.properties.append(prop)
         prop.parent = self
@@ -128,11 +176,17 @@ class ObjectProperty(Property):
         else:
             flags = ""
 
+        members = delim.join([p.make_member() for p in self.properties])
+        if not self.properties:
+            # Like nanopb, as C does not allow empty structs
+            flags = ""
+            members = "char dummy_field;"
+
         return (
             child_structs
             + f"""\
 struct {self.name} {{
-\t{flags}{delim.join([p.make_member() for p in self.properties])}
+\t{flags}{members}
 }};\
 """
         )
@@ -146,12 +200,16 @@ struct {self.name} {{
             if isinstance(p, ObjectProperty):
                 child_structs += p.make_str_buffer() + "\n\n"
 
-        str_properties = list(filter(lambda x: isinstance(x, StringProperty), self.properties))
+        str_properties = list(filter(lambda x: x.needs_buffer(), self.properties))
+        buffers = delim.join([p.make_buffer(string_buffer_size) for p in str_properties])
+        if not str_properties:
+            buffers = "char dummy_field;"
+
         return (
             child_structs
             + f"""\
 struct {self.name}_buffer {{
-\t{delim.join([p.make_buffer(string_buffer_size) for p in str_properties])}
+\t{buffers}
 }};\
 """
         )
@@ -183,15 +241,63 @@ static const struct json_obj_descr {self.name}_desc[] = {{
         return "\n".join(index(*t) for t in enumerate(self.properties))
 
 
-class StringProperty(Property):
+class PrimitiveProperty(Property):
+    # C type of the member, JSON token of the descriptor and name of the encode helper
+    c_type = None
+    token = None
+    helper = None
+
     def make_descriptor(self):
-        return f"JSON_OBJ_DESCR_PRIM(struct {self.parent.name}, {self.name}, JSON_TOK_STRING)"
+        return f"JSON_OBJ_DESCR_PRIM(struct {self.parent.name}, {self.name}, {self.token})"
+
+    def make_member(self):
+        return f"{self.c_type} {self.name};"
+
+    def make_encode(self, value):
+        return f"encode_{self.helper}({value}, append, data)"
+
+    def encode_helpers(self):
+        return {self.helper}
+
+    def make_copy(self, src, dst, buf):
+        return f"\t\t{dst}.{self.name} = {src}.{self.name};"
+
+    def make_differs(self, src, dst):
+        return f"{src}.{self.name} != {dst}.{self.name}"
+
+    def make_clear(self, value, buf):
+        return f"\t\t{value}.{self.name} = 0;"
+
+
+class StringProperty(PrimitiveProperty):
+    c_type = "const char *"
+    token = "JSON_TOK_STRING"
+    helper = "string"
 
     def make_member(self):
         return f"const char *{self.name};"
 
+    def needs_buffer(self):
+        return True
+
+    def buffer_size(self, default_size):
+        if "maxLength" in self.schema:
+            return self.schema["maxLength"] + 1
+        return default_size
+
     def make_buffer(self, size):
-        return f"char {self.name}[{size}];"
+        return f"char {self.name}[{self.buffer_size(size)}];"
+
+    def make_rebase(self, value, buf):
+        return f"\t\t{value}.{self.name} = {buf}.{self.name};"
+
+    def make_differs(self, src, dst):
+        return f"strcmp({src}.{self.name}, {dst}.{self.name}) != 0"
+
+    def make_clear(self, value, buf):
+        return f"""\
+		{value}.{self.name} = NULL;
+		memset({buf}.{self.name}, 0, sizeof({buf}.{self.name}));"""
 
     def make_copy(self, src, dst, buf):
         return f"""\
@@ -202,28 +308,244 @@ class StringProperty(Property):
 		{dst}.{self.name} = {buf}.{self.name};
 """
 
-class NumberProperty(Property):
+
+class NumberProperty(PrimitiveProperty):
+    c_type = "int32_t"
+    token = "JSON_TOK_NUMBER"
+    helper = "int32"
+
+
+class Int64Property(PrimitiveProperty):
+    c_type = "int64_t"
+    token = "JSON_TOK_INT64"
+    helper = "int64"
+
+
+class DoubleProperty(PrimitiveProperty):
+    c_type = "double"
+    token = "JSON_TOK_DOUBLE_FP"
+    helper = "double"
+
+
+class BooleanProperty(PrimitiveProperty):
+    c_type = "bool"
+    token = "JSON_TOK_TRUE"
+    helper = "bool"
+
+
+class ArrayProperty(Property):
+    def __init__(self, name, schema):
+        super().__init__(name, schema)
+        if "maxItems" not in schema:
+            raise TypeError(f"Array {name} needs maxItems")
+        self.max_items = schema["maxItems"]
+        self.item = Property.create(name, schema["items"])
+        if not isinstance(self.item, PrimitiveProperty):
+            raise TypeError(f"Array {name} must have items of a primitive type")
+
+    def len_name(self):
+        return f"{self.name}_len"
+
     def make_descriptor(self):
-        return f"JSON_OBJ_DESCR_PRIM(struct {self.parent.name}, {self.name}, JSON_TOK_NUMBER)"
+        return (
+            f"JSON_OBJ_DESCR_ARRAY(struct {self.parent.name}, {self.name}, "
+            f"{self.max_items}, {self.len_name()}, {self.item.token})"
+        )
 
     def make_member(self):
-        return f"int32_t {self.name};"
+        return f"{self.item.c_type}{'' if self.item.c_type.endswith('*') else ' '}{self.name}[{self.max_items}];\n\tsize_t {self.len_name()};"
+
+    def make_encode(self, value):
+        length = f"{value}_len"
+        return (
+            f"encode_{self.item.helper}_array({value}, "
+            f"MIN({length}, {self.max_items}), append, data)"
+        )
+
+    def encode_helpers(self):
+        return {self.item.helper, f"{self.item.helper}_array"}
+
+    def needs_buffer(self):
+        return self.item.needs_buffer()
+
+    def make_buffer(self, size):
+        return f"char {self.name}[{self.max_items}][{self.item.buffer_size(size)}];"
+
+    def make_rebase(self, value, buf):
+        return f"""\
+		for (size_t i = 0; i < MIN({value}.{self.len_name()}, {self.max_items}); i++) {{
+			{value}.{self.name}[i] = {buf}.{self.name}[i];
+		}}"""
+
+    def make_clear(self, value, buf):
+        clear = f"""\
+		memset({value}.{self.name}, 0, sizeof({value}.{self.name}));
+		{value}.{self.len_name()} = 0;"""
+        if self.item.needs_buffer():
+            clear += f"""
+		memset({buf}.{self.name}, 0, sizeof({buf}.{self.name}));"""
+        return clear
+
+    def make_differs(self, src, dst):
+        length = f"MIN({src}.{self.len_name()}, {self.max_items})"
+        if not self.item.needs_buffer():
+            return (
+                f"{length} != {dst}.{self.len_name()} ||\n\t\t    "
+                f"memcmp({src}.{self.name}, {dst}.{self.name}, "
+                f"{dst}.{self.len_name()} * sizeof({dst}.{self.name}[0])) != 0"
+            )
+
+        return (
+            f"{length} != {dst}.{self.len_name()} ||\n\t\t    "
+            f"strings_differ({src}.{self.name}, {dst}.{self.name}, {dst}.{self.len_name()})"
+        )
 
     def make_copy(self, src, dst, buf):
-        return f"\t\t{dst}.{self.name} = {src}.{self.name};"
+        if not self.item.needs_buffer():
+            return f"""\
+		{dst}.{self.len_name()} = MIN({src}.{self.len_name()}, {self.max_items});
+		memcpy({dst}.{self.name}, {src}.{self.name}, {dst}.{self.len_name()} * sizeof({dst}.{self.name}[0]));
+"""
+
+        return f"""\
+		if ({src}.{self.len_name()} > {self.max_items}) {{
+			return -ENOMEM;
+		}}
+		for (size_t i = 0; i < {src}.{self.len_name()}; i++) {{
+			if (strlen({src}.{self.name}[i]) >= sizeof({buf}.{self.name}[i])) {{
+				return -ENOMEM;
+			}}
+		}}
+		/* No stale strings are left behind in unused items */
+		memset({buf}.{self.name}, 0, sizeof({buf}.{self.name}));
+		for (size_t i = 0; i < {src}.{self.len_name()}; i++) {{
+			strncpy({buf}.{self.name}[i], {src}.{self.name}[i], sizeof({buf}.{self.name}[i]));
+			{dst}.{self.name}[i] = {buf}.{self.name}[i];
+		}}
+		{dst}.{self.len_name()} = {src}.{self.len_name()};
+"""
+
+
+def field_enum_name(prop, field):
+    return f"{prop.name.upper()}_FIELD_{field.name}"
+
+
+def make_field_enum(prop):
+    delim = "\n\t"
+    fields = [f"{field_enum_name(prop, p)}," for p in prop.properties]
+
+    return f"""\
+enum {prop.name}_field {{
+	{delim.join(fields)}
+	{prop.name.upper()}_FIELD_COUNT,
+}};
+
+/* Number of uint32_t words in a mask with one bit per field */
+#define {prop.name.upper()}_MASK_WORDS {max((len(prop.properties) + 31) // 32, 1)}
+
+{declare_field_from_name(prop)};
+
+{declare_field_name(prop)};\
+"""
+
+
+def declare_field_from_name(prop):
+    return f"int {prop.name}_field_from_name(const char *name)"
+
+
+def declare_field_name(prop):
+    return f"const char *{prop.name}_field_name(enum {prop.name}_field field)"
+
+
+def define_field_names(prop):
+    delim = "\n\t"
+    names = [f'[{field_enum_name(prop, p)}] = "{p.name}",' for p in prop.properties]
+
+    return f"""\
+static const char *const {prop.name}_field_names[] = {{
+	{delim.join(names)}
+}};
+
+{declare_field_from_name(prop)}
+{{
+	for (size_t i = 0; i < ARRAY_SIZE({prop.name}_field_names); i++) {{
+		if (strcmp(name, {prop.name}_field_names[i]) == 0) {{
+			return i;
+		}}
+	}}
+
+	return -ENOENT;
+}}
+
+{declare_field_name(prop)}
+{{
+	if ((size_t)field >= ARRAY_SIZE({prop.name}_field_names)) {{
+		return NULL;
+	}}
+
+	return {prop.name}_field_names[field];
+}}"""
+
+
+def declare_delete_fun(prop):
+    return f"size_t {prop.name}_delete_with_buffer(struct {prop.name} *current, struct {prop.name}_buffer *buffer, const uint32_t *fields, uint32_t *mask)"
+
+
+def define_delete_fun(prop):
+    delim = "\n"
+
+    def delete_checked(i, prop):
+        return f"""\
+	if ((fields[{i // 32}] & BIT({i % 32})) && current->has_{prop.name}) {{
+{prop.make_clear("(*current)", "(*buffer)")}
+		current->has_{prop.name} = false;
+		if (mask != NULL) {{
+			mask[{i // 32}] |= BIT({i % 32});
+		}}
+		deleted++;
+	}}
+"""
+
+    return f"""{declare_delete_fun(prop)}
+{{
+	size_t deleted = 0;
+
+{delim.join(delete_checked(*t) for t in enumerate(prop.properties))}
+	return deleted;
+}}"""
 
 
 def declare_update_fun(prop):
-    return f"ssize_t {prop.name}_update_with_buffer(const struct {prop.name} *changes, struct {prop.name} *current, struct {prop.name}_buffer *buffer)"
+    return f"ssize_t {prop.name}_update_with_buffer(const struct {prop.name} *changes, struct {prop.name} *current, struct {prop.name}_buffer *buffer, uint32_t *mask)"
+
+def needs_strings_differ(prop):
+    return any(isinstance(p, ArrayProperty) and p.needs_buffer() for p in prop.properties)
+
+def define_strings_differ():
+    return """\
+static bool strings_differ(const char *const *a, const char *const *b, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (strcmp(a[i], b[i]) != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}"""
 
 def define_update_fun(prop):
     delim = "\n"
 
-    def update_checked(prop):
+    def update_checked(i, prop):
         return f"""\
-	if (changes->has_{prop.name}) {{
+	if (changes->has_{prop.name} &&
+	    (!current->has_{prop.name} || {prop.make_differs("(*changes)", "(*current)")})) {{
 {prop.make_copy("(*changes)", "(*current)", "(*buffer)")}
 		current->has_{prop.name} = true;
+		if (mask != NULL) {{
+			mask[{i // 32}] |= BIT({i % 32});
+		}}
 		changed++;
 	}}
 """
@@ -236,12 +558,33 @@ def define_update_fun(prop):
 
 	size_t changed = 0;
 
-{delim.join(map(update_checked, prop.properties))}
+{delim.join(update_checked(*t) for t in enumerate(prop.properties))}
 
 	return changed;
 }}"""
 
 
+def declare_rebase_fun(prop):
+    return f"void {prop.name}_rebase_buffer(struct {prop.name} *v, struct {prop.name}_buffer *buffer)"
+
+def define_rebase_fun(prop):
+    delim = "\n"
+
+    def rebase_checked(prop):
+        return f"""\
+	if (v->has_{prop.name}) {{
+{prop.make_rebase("(*v)", "(*buffer)")}
+	}}
+"""
+
+    str_properties = filter(lambda x: x.needs_buffer(), prop.properties)
+
+    return f"""{declare_rebase_fun(prop)}
+{{
+{delim.join(map(rebase_checked, str_properties))}\
+}}"""
+
+
 def declare_parser(prop):
     return f"int {prop.name}_from_json(const char *json, size_t len, struct {prop.name} *v)"
 
@@ -271,50 +614,388 @@ def define_parser(prop):
 }}"""
 
 
-def declare_obj_desc_gen(prop):
-    return f"ssize_t {prop.name}_gen_obj_desc(const struct {prop.name} *v, struct json_obj_descr *od, size_t len)"
+def c_string(text):
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def make_append(literal):
+    return f"""\
+	ret = append({literal}, sizeof({literal}) - 1, data);
+	if (ret < 0) {{
+		return ret;
+	}}
+"""
+
+
+def make_object_encode(prop, value, optional):
+    """Statements encoding the object `value`, a pointer expression, member by member."""
+
+    code = ""
+
+    if optional and prop.properties:
+        code += "\tsize_t first = 1;\n\n"
+
+    code += make_append(c_string("{"))
+
+    for i, p in enumerate(prop.properties):
+        field = f"{value}->{p._name}"
+        if not optional:
+            key = c_string(("," if i > 0 else "") + f'"{p._name}":')
+            code += make_append(key)
+            if isinstance(p, ObjectProperty):
+                code += f"\t{{\n\t\tconst struct {p.name} *{p.name}_v = &{field};\n"
+                code += "\n".join("\t" + l if l else l for l in make_object_encode(p, f"{p.name}_v", False).split("\n"))
+                code += "\t}\n"
+            else:
+                code += f"""\
+	ret = {p.make_encode(field)};
+	if (ret < 0) {{
+		return ret;
+	}}
+"""
+            continue
+
+        key = c_string(f',"{p._name}":')
+        if isinstance(p, ObjectProperty):
+            inner = f"\t\tconst struct {p.name} *{p.name}_v = &{field};\n"
+            inner += "\n".join("\t" + l if l else l for l in make_object_encode(p, f"{p.name}_v", False).split("\n"))
+        else:
+            inner = f"""\
+		ret = {p.make_encode(field)};
+		if (ret < 0) {{
+			return ret;
+		}}
+"""
+        code += f"""
+	if ({value}->has_{p._name}) {{
+		ret = append(&{key}[first], sizeof({key}) - 1 - first, data);
+		if (ret < 0) {{
+			return ret;
+		}}
+		first = 0;
+
+{inner}	}}
+"""
+
+    code += "\n" + make_append(c_string("}"))
+    return code
+
+
+def make_object_encode_fun(prop):
+    # The last append can return directly
+    code = make_object_encode(prop, "v", optional=True)
+    tail = make_append(c_string("}"))
+    return code[: -len(tail)] + '\treturn append("}", 1, data);\n'
+
+
+ENCODE_HELPERS = {
+    "string": """\
+static int encode_string(const char *s, json_append_bytes_t append, void *data)
+{
+	const char *run = s;
+	int ret;
+
+	ret = append("\\"", 1, data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	for (; *s != '\\0'; s++) {
+		char esc[sizeof("\\\\u0000")] = {'\\\\'};
+		size_t esc_len = 2;
+
+		switch (*s) {
+		case '"':
+		case '\\\\':
+			esc[1] = *s;
+			break;
+		case '\\b':
+			esc[1] = 'b';
+			break;
+		case '\\f':
+			esc[1] = 'f';
+			break;
+		case '\\n':
+			esc[1] = 'n';
+			break;
+		case '\\r':
+			esc[1] = 'r';
+			break;
+		case '\\t':
+			esc[1] = 't';
+			break;
+		default:
+			if ((unsigned char)*s >= 0x20) {
+				continue;
+			}
+			esc_len = snprintk(esc, sizeof(esc), "\\\\u%04x", (unsigned char)*s);
+			break;
+		}
+
+		ret = append(run, s - run, data);
+		if (ret < 0) {
+			return ret;
+		}
+		ret = append(esc, esc_len, data);
+		if (ret < 0) {
+			return ret;
+		}
+		run = s + 1;
+	}
+
+	ret = append(run, s - run, data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return append("\\"", 1, data);
+}""",
+    "int64": """\
+static int encode_int64(int64_t value, json_append_bytes_t append, void *data)
+{
+	char digits[sizeof("-9223372036854775808")];
+	size_t i = sizeof(digits);
+	uint64_t v = value < 0 ? -(uint64_t)value : (uint64_t)value;
+
+	do {
+		digits[--i] = '0' + (v % 10);
+		v /= 10;
+	} while (v > 0);
+
+	if (value < 0) {
+		digits[--i] = '-';
+	}
+
+	return append(&digits[i], sizeof(digits) - i, data);
+}""",
+    "int32": """\
+static int encode_int32(int32_t value, json_append_bytes_t append, void *data)
+{
+	return encode_int64(value, append, data);
+}""",
+    "double": """\
+/* Fixed-point with up to six decimals, so no floating point formatting is needed. Values too
+ * large or too small for that use exponent notation with seven significant digits instead.
+ */
+static int encode_double(double value, json_append_bytes_t append, void *data)
+{
+	char digits[sizeof("-10000000000000.000000")];
+	size_t i = sizeof(digits);
+	bool negative = signbit(value);
+	int exponent = 0;
+
+	if (!isfinite(value)) {
+		/* Not representable in JSON */
+		return append("null", 4, data);
+	}
+
+	if (negative) {
+		value = -value;
+	}
+
+	if (value >= 1e13 || (value > 0.0 && value < 1e-3)) {
+		/* Normalize to [1, 10) */
+		while (value >= 10.0) {
+			value /= 10.0;
+			exponent++;
+		}
+		while (value < 1.0) {
+			value *= 10.0;
+			exponent--;
+		}
+		/* Rounding to seven digits might carry over, e.g. 9.9999999 */
+		if (value * 1000000.0 + 0.5 >= 10000000.0) {
+			value /= 10.0;
+			exponent++;
+		}
+
+		int e = exponent < 0 ? -exponent : exponent;
+
+		do {
+			digits[--i] = '0' + (e % 10);
+			e /= 10;
+		} while (e > 0);
+
+		if (exponent < 0) {
+			digits[--i] = '-';
+		}
+		digits[--i] = 'e';
+	}
+
+	/* Scale only the fraction, a whole value close to 1e13 scaled by 1e6 exceeds the precision
+	 * of a double
+	 */
+	uint64_t integer = (uint64_t)value;
+	uint32_t fraction = (uint32_t)((value - (double)integer) * 1000000.0 + 0.5);
+
+	if (fraction == 1000000) {
+		integer++;
+		fraction = 0;
+	}
+	if (integer == 0 && fraction == 0) {
+		/* No negative zero */
+		negative = false;
+	}
+
+	if (fraction > 0) {
+		size_t decimals = 6;
+
+		while (fraction % 10 == 0) {
+			fraction /= 10;
+			decimals--;
+		}
+
+		while (decimals-- > 0) {
+			digits[--i] = '0' + (fraction % 10);
+			fraction /= 10;
+		}
+		digits[--i] = '.';
+	}
+
+	do {
+		digits[--i] = '0' + (integer % 10);
+		integer /= 10;
+	} while (integer > 0);
+
+	if (negative) {
+		digits[--i] = '-';
+	}
+
+	return append(&digits[i], sizeof(digits) - i, data);
+}""",
+    "bool": """\
+static int encode_bool(bool value, json_append_bytes_t append, void *data)
+{
+	return value ? append("true", 4, data) : append("false", 5, data);
+}""",
+}
+
+# Helpers used by other helpers
+ENCODE_HELPER_DEPS = {
+    "int32": {"int64"},
+}
+
+ARRAY_ITEM_TYPES = {
+    "string": "const char *const",
+    "int32": "const int32_t",
+    "int64": "const int64_t",
+    "double": "const double",
+    "bool": "const bool",
+}
+
+
+def make_array_helper(item):
+    item_type = ARRAY_ITEM_TYPES[item]
+    return f"""\
+static int encode_{item}_array({item_type} *values, size_t len, json_append_bytes_t append,
+{" " * len(f"static int encode_{item}_array(")}void *data)
+{{
+	int ret;
+
+	ret = append("[", 1, data);
+	if (ret < 0) {{
+		return ret;
+	}}
+
+	for (size_t i = 0; i < len; i++) {{
+		if (i > 0) {{
+			ret = append(",", 1, data);
+			if (ret < 0) {{
+				return ret;
+			}}
+		}}
+
+		ret = encode_{item}(values[i], append, data);
+		if (ret < 0) {{
+			return ret;
+		}}
+	}}
+
+	return append("]", 1, data);
+}}"""
+
+
+def encode_helpers(prop):
+    helpers = set(prop.encode_helpers())
+    for h in list(helpers):
+        helpers |= ENCODE_HELPER_DEPS.get(h, set())
+    return helpers
+
+
+def make_encode_helpers(prop):
+    helpers = encode_helpers(prop)
+    # Scalar helpers first, they are used by the array helpers
+    order = [h for h in ENCODE_HELPERS if h in helpers]
+    order += [h for h in sorted(helpers) if h.endswith("_array")]
+    return "\n\n".join(
+        make_array_helper(h[: -len("_array")]) if h.endswith("_array") else ENCODE_HELPERS[h]
+        for h in order
+    )
 
 
 def declare_encoder(prop):
+    return f"int {prop.name}_to_json(const struct {prop.name} *v, json_append_bytes_t append, void *data)"
+
+
+def declare_to_buf(prop):
     return f"int {prop.name}_to_buf(const struct {prop.name} *v, char *json, size_t len)"
 
 
 def define_encoder(prop):
-    delim = "\n"
+    helpers = make_encode_helpers(prop)
 
-    def encode_property(prop):
-        return f"""\
-	if (v->has_{prop._name}) {{
-		if (descr_len >= len) {{
-			return -ENOMEM;
-		}}
-		od[descr_len] = (struct json_obj_descr){prop.make_descriptor()};
-		descr_len++;
-	}}
-"""
+    return f"""{helpers}
 
-    return f"""{declare_obj_desc_gen(prop)}
+{declare_encoder(prop)}
 {{
-	size_t descr_len = 0;
+	int ret;
+
+{make_object_encode_fun(prop)}}}
+
+struct {prop.name}_buf_ctx {{
+	char *json;
+	size_t len;
+	size_t pos;
+}};
 
-{delim.join(map(encode_property, prop.properties))}
-	return descr_len;
+static int {prop.name}_append_to_buf(const char *bytes, size_t len, void *data)
+{{
+	struct {prop.name}_buf_ctx *ctx = data;
+
+	/* Keep space for the zero delimiter */
+	if (len >= ctx->len - ctx->pos) {{
+		return -ENOMEM;
+	}}
+
+	memcpy(&ctx->json[ctx->pos], bytes, len);
+	ctx->pos += len;
+	ctx->json[ctx->pos] = '\\0';
+
+	return 0;
 }}
 
-{declare_encoder(prop)}
+{declare_to_buf(prop)}
 {{
-	struct json_obj_descr enc_descr[{prop.root_property().name.upper()}_VALUE_COUNT];
-	ssize_t descr_len = 0;
+	struct {prop.name}_buf_ctx ctx = {{
+		.json = json,
+		.len = len,
+	}};
 
-	descr_len = {prop.name}_gen_obj_desc(v, enc_descr, ARRAY_SIZE(enc_descr));
-	if (descr_len <= 0) {{
-		return descr_len;
+	if (len == 0) {{
+		return -ENOMEM;
 	}}
 
-	return json_obj_encode_buf(enc_descr, descr_len, v, json, len);
+	return {prop.name}_to_json(v, {prop.name}_append_to_buf, &ctx);
 }}"""
 
 
+def layout_hash(prop, string_buffer_size):
+    layout = prop.make_struct()
+    if string_buffer_size > 0:
+        layout += prop.make_str_buffer(string_buffer_size)
+    return zlib.crc32(layout.encode())
+
+
 def write_header(path, prop, gen_parser, gen_encoder, gen_update_function, string_buffer_size):
     filename = prop.module_name() + ".h"
     guard = prop.module_name().upper() + "_H"
@@ -335,6 +1016,9 @@ def write_header(path, prop, gen_parser, gen_encoder, gen_update_function, strin
 
 #define {prop.root_property().name.upper()}_VALUE_COUNT {len(prop.properties)}
 
+/* Changes with the names, types and buffer sizes of the members, e.g. to tag stored values */
+#define {prop.root_property().name.upper()}_LAYOUT_HASH {layout_hash(prop, string_buffer_size):#010x}u
+
 {prop.make_struct()}
 """
         )
@@ -349,7 +1033,13 @@ def write_header(path, prop, gen_parser, gen_encoder, gen_update_function, strin
         if gen_update_function:
             h.write(
                 f"""
+{make_field_enum(prop)}
+
 {declare_update_fun(prop)};
+
+{declare_rebase_fun(prop)};
+
+{declare_delete_fun(prop)};
 """
             )
 
@@ -366,9 +1056,9 @@ def write_header(path, prop, gen_parser, gen_encoder, gen_update_function, strin
         if gen_encoder:
             h.write(
                 f"""
-{declare_obj_desc_gen(prop)};
-
 {declare_encoder(prop)};
+
+{declare_to_buf(prop)};
 """
             )
 
@@ -391,13 +1081,42 @@ def write_source(path, prop, gen_parser, gen_encoder, gen_update_function):
 #include <errno.h>
 #include <stddef.h>
 #include <string.h>
+
+#include <zephyr/sys/util.h>
+"""
+        )
+
+        if gen_encoder:
+            src.write(
+                f"""\
+#include <zephyr/sys/printk.h>
+"""
+            )
+
+        if gen_encoder and "double" in encode_helpers(prop):
+            src.write(
+                f"""\
+#include <math.h>
 """
         )
 
+        if gen_update_function and needs_strings_differ(prop):
+            src.write(
+                f"""
+{define_strings_differ()}
+"""
+            )
+
         if gen_update_function:
             src.write(
                 f"""
 {define_update_fun(prop)}
+
+{define_rebase_fun(prop)}
+
+{define_delete_fun(prop)}
+
+{define_field_names(prop)}
 """
             )
 
@@ -418,6 +1137,17 @@ def write_source(path, prop, gen_parser, gen_encoder, gen_update_function):
             )
 
 
+def write_cmake_sizes(path, prop, string_buffer_size):
+    filename = prop.name + "_sizes.cmake"
+    outpath = os.path.abspath(os.path.join(path, filename))
+    print(f"Generating {outpath}")
+    with open(outpath, "w") as f:
+        f.write("# Sizes of the string buffers, including the terminator\n")
+        for p in prop.properties:
+            if isinstance(p, StringProperty):
+                f.write(f"set({prop.name}_{p.name}_max_size {p.buffer_size(string_buffer_size)})\n")
+
+
 def load_schema(path):
     filename = os.path.basename(path)
     schema_name, ext = os.path.splitext(filename)
@@ -455,6 +1185,7 @@ def load_schema(path):
     "--string-buffer-size",
     default=32,
     type=int,
+    help="Size of string buffers, for strings without maxLength",
 )
 @click.option(
     "-u",
@@ -463,8 +1194,21 @@ def load_schema(path):
     is_flag=True,
     help="Generate Update function",
 )
+@click.option(
+    "-c",
+    "--cmake-sizes",
+    default=False,
+    is_flag=True,
+    help="Only write the sizes of the string buffers as CMake variables",
+)
 def gen_json_parser(
-    outpath: str, json_schema_files: tuple[str, ...], gen_parser, gen_encoder, string_buffer_size, gen_update_function,
+    outpath: str,
+    json_schema_files: tuple[str, ...],
+    gen_parser,
+    gen_encoder,
+    string_buffer_size,
+    gen_update_function,
+    cmake_sizes,
 ):
     """
     Generate zephyr based json parser and encoder from
@@ -479,6 +1223,9 @@ def gen_json_parser(
     prop = load_schema(json_schema_files[0])
     for path in json_schema_files[1:]:
         prop.merge_with(load_schema(path))
+    if cmake_sizes:
+        write_cmake_sizes(outpath, prop, string_buffer_size)
+        return
     write_header(outpath, prop, gen_parser, gen_encoder, gen_update_function, string_buffer_size)
     write_source(outpath, prop, gen_parser, gen_encoder, gen_update_function)
 
@@ -123,14 +123,19 @@ static int make_provisioning_request(const char *device_name)
 					  "\"%s\",\"provisionDeviceSecret\": \"%s\"}";
 	int err;
 
-	struct thingsboard_request *request = thingsboard_request_alloc();
+	err = snprintf(NULL, 0, request_fmt, device_name, prov_key, prov_secret);
+	if (err < 0) {
+		return -EINVAL;
+	}
+
+	struct thingsboard_request *request = thingsboard_request_alloc(err + 1);
 	if (request == NULL) {
 		return -ENOMEM;
 	}
 
-	err = snprintf(request->payload, sizeof(request->payload), request_fmt, device_name,
+	err = snprintf(request->payload, request->payload_size, request_fmt, device_name,
 		       prov_key, prov_secret);
-	if (err < 0 || err >= sizeof(request->payload)) {
+	if (err < 0 || err >= request->payload_size) {
 		err = -ENOMEM;
 		goto error;
 	}
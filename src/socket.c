@@ -137,6 +137,9 @@ __weak int thingsboard_socket_resume(int *sock)
 
 #elif defined CONFIG_THINGSBOARD_SOCKET_SUSPEND_DISCONNECT
 
+/* Attribute notifications have been observed before suspending */
+static bool resubscribe;
+
 int thingsboard_socket_suspend(int *sock)
 {
 	__ASSERT_NO_MSG(sock != NULL);
@@ -145,6 +148,7 @@ int thingsboard_socket_suspend(int *sock)
 	if (err == -EALREADY) {
 		LOG_DBG("Was not subscribed to attributes notification");
 	}
+	resubscribe = err == 0;
 
 	thingsboard_socket_close(*sock);
 	*sock = -1;
@@ -166,6 +170,10 @@ int thingsboard_socket_resume(int *sock)
 
 	*sock = ret;
 
+	if (!resubscribe) {
+		return 0;
+	}
+
 	ret = thingsboard_client_subscribe_attributes();
 	if (ret < 0) {
 		LOG_ERR("Failed to observe attributes: %d", ret);
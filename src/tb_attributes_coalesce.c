@@ -0,0 +1,100 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <thingsboard.h>
+
+#include "tb_internal.h"
+
+LOG_MODULE_REGISTER(tb_attributes_coalesce, CONFIG_THINGSBOARD_LOG_LEVEL);
+
+/* All attributes received since the last update has been applied, protected by the Thingsboard
+ * lock
+ */
+static struct {
+	thingsboard_attributes attributes;
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	struct thingsboard_attributes_buffer buffer;
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	/* Attributes deleted since, and not set again afterwards */
+	uint32_t deleted[THINGSBOARD_ATTRIBUTES_MASK_WORDS];
+	/* Metadata of the latest update or deletion of each attribute */
+	struct thingsboard_attributes_meta meta;
+	bool valid;
+	/* Uptime when the first notification of this update was received */
+	int64_t first_at;
+} pending;
+
+static void coalesce_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(coalesce_work, coalesce_work_fn);
+
+static void coalesce_work_fn(struct k_work *work)
+{
+	thingsboard_lock();
+
+	if (pending.valid) {
+		LOG_DBG("Applying attributes received within %lld ms",
+			k_uptime_get() - pending.first_at);
+		thingsboard_attributes_apply(&pending.attributes, pending.deleted, &pending.meta);
+		pending.valid = false;
+	}
+
+	thingsboard_unlock();
+}
+
+void thingsboard_attributes_coalesce(thingsboard_attributes *attr, const uint32_t *deleted,
+				     const struct thingsboard_attributes_meta *meta)
+{
+	uint32_t merged[THINGSBOARD_ATTRIBUTES_MASK_WORDS] = {0};
+	int64_t now = k_uptime_get();
+
+	if (!pending.valid) {
+		pending.attributes = (thingsboard_attributes){0};
+		memset(pending.deleted, 0, sizeof(pending.deleted));
+		pending.meta = (struct thingsboard_attributes_meta){0};
+		pending.first_at = now;
+	}
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	void *buffer = &pending.buffer;
+	size_t buffer_len = sizeof(pending.buffer);
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	void *buffer = NULL;
+	size_t buffer_len = 0;
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+	/* A deletion overrides values received before it */
+	ssize_t ret = thingsboard_attributes_delete(&pending.attributes, buffer, buffer_len,
+						    deleted, NULL);
+	if (ret < 0) {
+		LOG_ERR("Failed to merge deleted shared attributes: %d", (int)ret);
+		return;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(pending.deleted); i++) {
+		pending.deleted[i] |= deleted[i];
+	}
+
+	ret = thingsboard_attributes_update(attr, &pending.attributes, buffer, buffer_len, merged);
+	if (ret < 0) {
+		LOG_ERR("Failed to merge shared attributes: %d", (int)ret);
+		return;
+	}
+
+	/* A value received after a deletion overrides it */
+	for (size_t i = 0; i < ARRAY_SIZE(pending.deleted); i++) {
+		pending.deleted[i] &= ~merged[i];
+	}
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF
+	thingsboard_attributes_meta_merge(&pending.meta, meta);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF */
+
+	pending.valid = true;
+
+	int64_t deadline = pending.first_at + CONFIG_THINGSBOARD_ATTRIBUTES_COALESCE_MAX_DELAY_MS;
+	int64_t delay = MIN(CONFIG_THINGSBOARD_ATTRIBUTES_COALESCE_WINDOW_MS, deadline - now);
+
+	(void)k_work_reschedule(&coalesce_work, K_MSEC(MAX(delay, 0)));
+}
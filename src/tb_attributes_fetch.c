@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/coap.h>
+
+#include <thingsboard.h>
+
+#include "tb_internal.h"
+
+LOG_MODULE_REGISTER(tb_attributes_fetch, CONFIG_THINGSBOARD_LOG_LEVEL);
+
+/* Fetch in progress, protected by the Thingsboard lock */
+static struct {
+	/* Path including the query, referenced by the CoAP client until the request completed */
+	char path[CONFIG_THINGSBOARD_ATTRIBUTES_FETCH_MAX_PATH_LENGTH];
+	thingsboard_attributes_fetch_callback_t cb;
+	void *user_data;
+	bool busy;
+} fetch;
+
+/* Build `<attributes path>?sharedKeys=<key>,<key>,...`. Client side attributes are published by
+ * the device itself, so they are never fetched.
+ */
+static int fetch_build_path(const uint32_t *fields)
+{
+	const char *sep = "?sharedKeys=";
+	size_t keys = 0;
+
+	int ret = snprintf(fetch.path, sizeof(fetch.path), "%s", thingsboard_client.paths.attributes);
+	if (ret < 0 || (size_t)ret >= sizeof(fetch.path)) {
+		return -ENOMEM;
+	}
+	size_t pos = ret;
+
+	for (int i = 0; i < THINGSBOARD_ATTRIBUTES_FIELD_COUNT; i++) {
+		if (!thingsboard_attributes_mask_test(fields, i)) {
+			continue;
+		}
+
+		ret = snprintf(&fetch.path[pos], sizeof(fetch.path) - pos, "%s%s", sep,
+			       thingsboard_attributes_field_name(i));
+		if (ret < 0 || (size_t)ret >= sizeof(fetch.path) - pos) {
+			return -ENOMEM;
+		}
+		pos += ret;
+		sep = ",";
+		keys++;
+	}
+
+	return keys > 0 ? 0 : -EINVAL;
+}
+
+static void fetch_handle_response(int16_t result_code, size_t offset, const uint8_t *payload,
+				  size_t len, bool last_block, void *user_data)
+{
+	uint32_t deleted[THINGSBOARD_ATTRIBUTES_MASK_WORDS] = {0};
+	struct thingsboard_attributes_meta meta = {0};
+	thingsboard_attributes attr = {0};
+	int err;
+
+	if (result_code < 0) {
+		LOG_ERR("Fetching attributes failed: %d", result_code);
+		err = result_code;
+	} else if (offset > 0 || !last_block) {
+		/* Block-wise responses are not buffered, wait for the transfer to end */
+		if (!last_block) {
+			return;
+		}
+		LOG_ERR("Fetched attributes do not fit into a single CoAP message");
+		err = -EMSGSIZE;
+	} else if (result_code != COAP_RESPONSE_CODE_CONTENT) {
+		LOG_ERR("Unexpected response code for attributes fetch: %d", result_code);
+		err = -EBADMSG;
+	} else {
+		LOG_HEXDUMP_DBG(payload, len, "Fetched attributes");
+
+		err = thingsboard_attributes_response_decode(payload, len, &attr, &meta);
+		if (err < 0) {
+			LOG_ERR("Parsing fetched attributes failed");
+		}
+	}
+
+	thingsboard_lock();
+
+	if (err == 0) {
+		thingsboard_attributes_apply(&attr, deleted, &meta);
+	}
+
+	thingsboard_attributes_fetch_callback_t cb = fetch.cb;
+	void *cb_user_data = fetch.user_data;
+
+	fetch.busy = false;
+
+	thingsboard_unlock();
+
+	/* Without the lock held, the callback can start the next fetch right away */
+	if (cb != NULL) {
+		cb(err, err < 0 ? NULL : &attr, cb_user_data);
+	}
+}
+
+static int fetch_start(const uint32_t *fields, thingsboard_attributes_fetch_callback_t cb,
+		       void *user_data)
+{
+	if (fetch.busy) {
+		return -EBUSY;
+	}
+
+	int err = fetch_build_path(fields);
+	if (err < 0) {
+		return err;
+	}
+
+	fetch.cb = cb;
+	fetch.user_data = user_data;
+	fetch.busy = true;
+
+	struct coap_client_request coap_request = {
+		.confirmable = true,
+		.method = COAP_METHOD_GET,
+		.path = fetch.path,
+		.cb = fetch_handle_response,
+	};
+
+	err = coap_client_req(&thingsboard_client.coap_client, thingsboard_client.server_socket,
+			      (struct sockaddr *)thingsboard_client.server_address, &coap_request,
+			      NULL);
+	if (err < 0) {
+		LOG_ERR("Failed to send attributes fetch: %d", err);
+		fetch.busy = false;
+		return -EIO;
+	}
+
+	LOG_DBG("Attributes fetch request sent");
+
+	return 0;
+}
+
+int thingsboard_attributes_fetch_on_connect(void)
+{
+	const struct thingsboard_configuration *config = thingsboard_client.config;
+
+	int err = fetch_start(config->fetch_attributes, config->fetch_callback, NULL);
+	if (err < 0) {
+		LOG_ERR("Failed to fetch attributes: %d", err);
+	}
+
+	return err;
+}
+
+int thingsboard_observe_attributes(void)
+{
+	int err;
+
+	thingsboard_lock();
+
+	if (!thingsboard_is_active()) {
+		err = -EAGAIN;
+	} else if (thingsboard_client.attributes_observation != NULL) {
+		err = -EALREADY;
+	} else {
+		err = thingsboard_client_subscribe_attributes();
+	}
+
+	thingsboard_unlock();
+
+	return err;
+}
+
+int thingsboard_fetch_attributes(const uint32_t *fields, thingsboard_attributes_fetch_callback_t cb,
+				 void *user_data)
+{
+	__ASSERT_NO_MSG(fields);
+
+	thingsboard_lock();
+
+	if (!thingsboard_is_active()) {
+		thingsboard_unlock();
+		return -EAGAIN;
+	}
+
+	int err = fetch_start(fields, cb, user_data);
+
+	thingsboard_unlock();
+
+	return err;
+}
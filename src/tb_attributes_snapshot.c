@@ -0,0 +1,51 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+
+#include <thingsboard.h>
+
+#include "tb_internal.h"
+
+/*
+ * Two copies of the shared attributes. The notification handler fills the one not in use and
+ * publishes it by incrementing `seq`, whose lowest bit selects the copy readers take. A reader
+ * retries if `seq` changed while copying, as the copy it read might have been overwritten by the
+ * next update.
+ */
+static struct {
+	struct thingsboard_attributes_snapshot slots[2];
+	atomic_t seq;
+} snapshot;
+
+void thingsboard_attributes_snapshot_publish(void)
+{
+	atomic_val_t seq = atomic_get(&snapshot.seq);
+	struct thingsboard_attributes_snapshot *slot = &snapshot.slots[(seq + 1) & 1];
+
+	slot->attributes = thingsboard_client.shared_attributes;
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	slot->buffer = thingsboard_client.shared_attributes_buffer;
+	thingsboard_attributes_rebase_buffer(&slot->attributes, &slot->buffer);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+	barrier_dmem_fence_full();
+	atomic_set(&snapshot.seq, seq + 1);
+}
+
+void thingsboard_get_attributes_snapshot(struct thingsboard_attributes_snapshot *out)
+{
+	atomic_val_t seq;
+
+	__ASSERT_NO_MSG(out);
+
+	do {
+		seq = atomic_get(&snapshot.seq);
+		*out = snapshot.slots[seq & 1];
+		barrier_dmem_fence_full();
+	} while (atomic_get(&snapshot.seq) != seq);
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	/* The strings still point into the slot */
+	thingsboard_attributes_rebase_buffer(&out->attributes, &out->buffer);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+}
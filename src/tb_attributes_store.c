@@ -0,0 +1,151 @@
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+
+#include "tb_internal.h"
+
+LOG_MODULE_REGISTER(tb_attributes_store, CONFIG_THINGSBOARD_LOG_LEVEL);
+
+#define THINGSBOARD_ATTRIBUTES_SETTINGS_KEY "thingsboard/attributes"
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+#define ATTRIBUTES_LAYOUT THINGSBOARD_ATTRIBUTES_LAYOUT_HASH
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+#define LAYOUT_FIELD(a, atype, htype, ltype, name, tag) #atype #htype #ltype #name #tag ";"
+/* Fields of the message, as listed by nanopb */
+static const char attributes_fields[] = thingsboard_attributes_FIELDLIST(LAYOUT_FIELD, 0);
+#define ATTRIBUTES_LAYOUT crc32_ieee((const uint8_t *)attributes_fields, sizeof(attributes_fields))
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+/*
+ * The shared attributes are stored as one settings value. JSON string pointers are stored as
+ * they are and pointed at the restored buffer when loading.
+ */
+struct attributes_record {
+	/* Identifies the layout of `thingsboard_attributes`, records of other layouts are ignored */
+	uint32_t layout;
+	thingsboard_attributes attributes;
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	struct thingsboard_attributes_buffer buffer;
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+};
+
+static struct attributes_record record;
+/* Checksum of the stored record, used to skip writing unchanged attributes */
+static uint32_t stored_crc;
+
+static void store_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(store_work, store_work_fn);
+
+/* Must be called with the Thingsboard lock held */
+static uint32_t record_from_client(void)
+{
+	record.layout = ATTRIBUTES_LAYOUT;
+	memcpy(&record.attributes, &thingsboard_client.shared_attributes, sizeof(record.attributes));
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	memcpy(&record.buffer, &thingsboard_client.shared_attributes_buffer, sizeof(record.buffer));
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+	return crc32_ieee((const uint8_t *)&record, sizeof(record));
+}
+
+static void store_work_fn(struct k_work *work)
+{
+	thingsboard_lock();
+	uint32_t crc = record_from_client();
+	thingsboard_unlock();
+
+	if (crc == stored_crc) {
+		LOG_DBG("Shared attributes unchanged, not storing them");
+		return;
+	}
+
+	int err = settings_save_one(THINGSBOARD_ATTRIBUTES_SETTINGS_KEY, &record, sizeof(record));
+	if (err < 0) {
+		LOG_ERR("Failed to store shared attributes: %d", err);
+		return;
+	}
+
+	LOG_DBG("Stored shared attributes, %zu B", sizeof(record));
+	stored_crc = crc;
+}
+
+static int record_read_cb(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg,
+			  void *param)
+{
+	bool *loaded = param;
+
+	if (len != sizeof(record)) {
+		LOG_WRN("Ignoring stored shared attributes of %zu B, expected %zu B", len,
+			sizeof(record));
+		return 0;
+	}
+
+	ssize_t ret = read_cb(cb_arg, &record, len);
+	if (ret != (ssize_t)len) {
+		LOG_ERR("Failed to read stored shared attributes: %d", (int)ret);
+		return 0;
+	}
+
+	if (record.layout != ATTRIBUTES_LAYOUT) {
+		LOG_WRN("Ignoring stored shared attributes of another layout");
+		return 0;
+	}
+
+	*loaded = true;
+
+	return 0;
+}
+
+int thingsboard_attributes_store_init(void)
+{
+	bool loaded = false;
+	int err;
+
+	err = settings_subsys_init();
+	if (err < 0) {
+		LOG_ERR("Failed to initialize settings subsystem: %d", err);
+		return err;
+	}
+
+	err = settings_load_subtree_direct(THINGSBOARD_ATTRIBUTES_SETTINGS_KEY, record_read_cb,
+					   &loaded);
+	if (err < 0) {
+		return err;
+	}
+
+	if (!loaded) {
+		return 0;
+	}
+
+	thingsboard_lock();
+
+	memcpy(&thingsboard_client.shared_attributes, &record.attributes,
+	       sizeof(thingsboard_client.shared_attributes));
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	memcpy(&thingsboard_client.shared_attributes_buffer, &record.buffer,
+	       sizeof(thingsboard_client.shared_attributes_buffer));
+	thingsboard_attributes_rebase_buffer(&thingsboard_client.shared_attributes,
+					     &thingsboard_client.shared_attributes_buffer);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+	stored_crc = record_from_client();
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_SNAPSHOT
+	thingsboard_attributes_snapshot_publish();
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_SNAPSHOT */
+
+	thingsboard_unlock();
+
+	LOG_INF("Restored shared attributes from settings");
+
+	return 0;
+}
+
+void thingsboard_attributes_store_changed(void)
+{
+	(void)k_work_schedule(&store_work, K_MSEC(CONFIG_THINGSBOARD_ATTRIBUTES_STORE_DELAY_MS));
+}
@@ -0,0 +1,68 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+#include <thingsboard.h>
+
+#include "tb_internal.h"
+
+static sys_slist_t subscriptions = SYS_SLIST_STATIC_INIT(&subscriptions);
+
+static bool mask_intersects(const uint32_t *a, const uint32_t *b)
+{
+	for (size_t i = 0; i < THINGSBOARD_ATTRIBUTES_MASK_WORDS; i++) {
+		if ((a[i] & b[i]) != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int thingsboard_attributes_subscribe(struct thingsboard_attributes_subscription *subscription)
+{
+	int err = 0;
+
+	__ASSERT_NO_MSG(subscription);
+	__ASSERT_NO_MSG(subscription->cb);
+
+	thingsboard_lock();
+
+	if (sys_slist_find(&subscriptions, &subscription->node, NULL)) {
+		err = -EALREADY;
+	} else {
+		sys_slist_append(&subscriptions, &subscription->node);
+	}
+
+	thingsboard_unlock();
+
+	return err;
+}
+
+int thingsboard_attributes_unsubscribe(struct thingsboard_attributes_subscription *subscription)
+{
+	int err = 0;
+
+	__ASSERT_NO_MSG(subscription);
+
+	thingsboard_lock();
+
+	if (!sys_slist_find_and_remove(&subscriptions, &subscription->node)) {
+		err = -ENOENT;
+	}
+
+	thingsboard_unlock();
+
+	return err;
+}
+
+void thingsboard_attributes_dispatch(const uint32_t *changed)
+{
+	struct thingsboard_attributes_subscription *subscription, *next;
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&subscriptions, subscription, next, node) {
+		if (mask_intersects(subscription->fields, changed)) {
+			subscription->cb(&thingsboard_client.shared_attributes, changed,
+					 subscription->user_data);
+		}
+	}
+}
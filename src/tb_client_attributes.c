@@ -0,0 +1,205 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/coap.h>
+
+#include <thingsboard.h>
+
+#include "tb_internal.h"
+
+LOG_MODULE_REGISTER(tb_client_attributes, CONFIG_THINGSBOARD_LOG_LEVEL);
+
+#define PUBLISH_DELAY  K_MSEC(CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES_DELAY_MS)
+#define RETRY_INTERVAL K_MSEC(CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES_RETRY_INTERVAL_MS)
+
+/* One state of the client attributes, including storage for its strings */
+struct client_attributes {
+	thingsboard_client_attributes values;
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	struct thingsboard_client_attributes_buffer buffer;
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+};
+
+static struct {
+	/* All attributes set by the application */
+	struct client_attributes desired;
+	/* Attributes last acknowledged by Thingsboard */
+	struct client_attributes acked;
+	/* Attributes known to Thingsboard, once the upload in flight is acknowledged */
+	struct client_attributes sent;
+	/* Changed attributes only, encoded into the upload */
+	struct client_attributes upload;
+	bool in_flight;
+} state;
+
+static K_MUTEX_DEFINE(client_attributes_lock);
+
+static void flush_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(flush_work, flush_work_fn);
+
+static ssize_t attrs_update(struct client_attributes *attrs,
+			    const thingsboard_client_attributes *changes, uint32_t *mask)
+{
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	return thingsboard_client_attributes_update(changes, &attrs->values, &attrs->buffer,
+						    sizeof(attrs->buffer), mask);
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	return thingsboard_client_attributes_update(changes, &attrs->values, NULL, 0, mask);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+}
+
+static void attrs_copy(struct client_attributes *dst, const struct client_attributes *src)
+{
+	/* Strings fit, as both use the same buffer sizes */
+	dst->values = (thingsboard_client_attributes){0};
+	(void)attrs_update(dst, &src->values, NULL);
+}
+
+static void attrs_delete(struct client_attributes *attrs, const uint32_t *fields)
+{
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	(void)thingsboard_client_attributes_delete(&attrs->values, &attrs->buffer,
+						   sizeof(attrs->buffer), fields, NULL);
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	(void)thingsboard_client_attributes_delete(&attrs->values, NULL, 0, fields, NULL);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+}
+
+static void client_attributes_handle_response(int16_t result_code, size_t offset,
+					      const uint8_t *payload, size_t len, bool last_block,
+					      void *user_data)
+{
+	struct thingsboard_request *request = user_data;
+
+	if (!last_block) {
+		return;
+	}
+
+	(void)k_mutex_lock(&client_attributes_lock, K_FOREVER);
+
+	state.in_flight = false;
+
+	/* Response codes of class 2 indicate success */
+	if (result_code >= 0 && (result_code >> 5) == 2) {
+		attrs_copy(&state.acked, &state.sent);
+		/* Send attributes set while the upload was in flight */
+		(void)k_work_schedule(&flush_work, K_NO_WAIT);
+	} else {
+		LOG_WRN("Failed to publish client attributes: %d", result_code);
+		(void)k_work_reschedule(&flush_work, RETRY_INTERVAL);
+	}
+
+	(void)k_mutex_unlock(&client_attributes_lock);
+
+	thingsboard_request_free(request);
+}
+
+static int flush_locked(void)
+{
+	uint32_t changed[THINGSBOARD_CLIENT_ATTRIBUTES_MASK_WORDS] = {0};
+
+	if (state.in_flight) {
+		return -EBUSY;
+	}
+
+	if (!thingsboard_is_active()) {
+		return -EAGAIN;
+	}
+
+	attrs_copy(&state.sent, &state.acked);
+	ssize_t count = attrs_update(&state.sent, &state.desired.values, changed);
+	if (count <= 0) {
+		return count;
+	}
+
+	/* Only upload the attributes differing from the acknowledged ones */
+	for (size_t i = 0; i < ARRAY_SIZE(changed); i++) {
+		changed[i] = ~changed[i];
+	}
+	attrs_copy(&state.upload, &state.sent);
+	attrs_delete(&state.upload, changed);
+
+	struct thingsboard_request *request =
+		thingsboard_request_alloc(CONFIG_COAP_CLIENT_MESSAGE_SIZE);
+	if (request == NULL) {
+		return -ENOMEM;
+	}
+
+	size_t len = request->payload_size;
+	int err = thingsboard_client_attributes_encode(&state.upload.values, request->payload, &len);
+	if (err < 0) {
+		thingsboard_request_free(request);
+		return -EINVAL;
+	}
+
+	thingsboard_request_shrink(request, len);
+
+	struct coap_client_request coap_request = {
+		.payload = request->payload,
+		.len = len,
+		.confirmable = true,
+		.method = COAP_METHOD_POST,
+		.fmt = THINGSBOARD_DEFAULT_CONTENT_FORMAT,
+		.path = thingsboard_client.paths.attributes,
+		.cb = client_attributes_handle_response,
+		.user_data = request,
+	};
+
+	state.in_flight = true;
+
+	err = coap_client_req(&thingsboard_client.coap_client, thingsboard_client.server_socket,
+			      (struct sockaddr *)thingsboard_client.server_address, &coap_request,
+			      NULL);
+	if (err < 0) {
+		LOG_ERR("Failed to send client attributes: %d", err);
+		state.in_flight = false;
+		thingsboard_request_free(request);
+		return -EIO;
+	}
+
+	LOG_DBG("Sent %zi client attributes", count);
+
+	return 0;
+}
+
+static void flush_work_fn(struct k_work *work)
+{
+	(void)k_mutex_lock(&client_attributes_lock, K_FOREVER);
+
+	/* With an upload in flight, its completion schedules the work again */
+	int err = flush_locked();
+	if (err < 0 && err != -EBUSY) {
+		(void)k_work_reschedule(k_work_delayable_from_work(work), RETRY_INTERVAL);
+	}
+
+	(void)k_mutex_unlock(&client_attributes_lock);
+}
+
+int thingsboard_set_client_attributes(const thingsboard_client_attributes *attributes)
+{
+	__ASSERT_NO_MSG(attributes);
+
+	(void)k_mutex_lock(&client_attributes_lock, K_FOREVER);
+
+	ssize_t ret = attrs_update(&state.desired, attributes, NULL);
+	if (ret > 0) {
+		(void)k_work_schedule(&flush_work, PUBLISH_DELAY);
+	}
+
+	(void)k_mutex_unlock(&client_attributes_lock);
+
+	return ret < 0 ? -ENOMEM : 0;
+}
+
+int thingsboard_flush_client_attributes(void)
+{
+	(void)k_mutex_lock(&client_attributes_lock, K_FOREVER);
+
+	int err = flush_locked();
+	if (err == 0) {
+		(void)k_work_cancel_delayable(&flush_work);
+	}
+
+	(void)k_mutex_unlock(&client_attributes_lock);
+
+	return err;
+}
@@ -85,6 +85,9 @@ static int fw_apply(void)
 	client_set_fw_state(TB_FW_UPDATING);
 	k_sleep(K_SECONDS(5));
 	dfu_target_mcuboot_schedule_update(0);
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+	thingsboard_telemetry_backlog_flush();
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
 	sys_reboot(SYS_REBOOT_COLD);
 
 	return 0;
@@ -173,22 +176,18 @@ static int client_fw_request_image(void)
 {
 	int err;
 
-	struct thingsboard_request *request = thingsboard_request_alloc();
+	/* Use the payload buffer for the complete path, since its not used for GET requests and
+	 * tends to get quite long */
+	struct thingsboard_request *request = thingsboard_request_alloc(
+		strlen(thingsboard_client.paths.firmware) + sizeof("?title=&version=") +
+		strlen(tb_fota_ctx.title) + strlen(tb_fota_ctx.version));
 	if (request == NULL) {
 		return -ENOMEM;
 	}
 
-	err = thingsboard_cat_path(THINGSBOARD_PATH_FIRMWARE, request->path, sizeof(request->path));
-	if (err < 0) {
-		thingsboard_request_free(request);
-		return -EFAULT;
-	}
-
-	/* Use the payload buffer for the complete path, since its not used for GET requests and
-	 * tends to get quite long */
-	err = snprintf(request->payload, sizeof(request->payload), "%s?title=%s&version=%s",
-		       request->path, tb_fota_ctx.title, tb_fota_ctx.version);
-	if (err < 0 || err >= sizeof(request->payload)) {
+	err = snprintf(request->payload, request->payload_size, "%s?title=%s&version=%s",
+		       thingsboard_client.paths.firmware, tb_fota_ctx.title, tb_fota_ctx.version);
+	if (err < 0 || err >= request->payload_size) {
 		thingsboard_request_free(request);
 		return -EFAULT;
 	}
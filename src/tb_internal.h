@@ -52,10 +52,43 @@ typedef struct {
 #endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
 
 struct thingsboard_request {
-	void (*rpc_cb)(const uint8_t *payload, size_t len);
+	void (*rpc_cb)(const uint8_t *payload, size_t len, int64_t sent_at);
 	struct coap_client_option options[1];
-	char path[CONFIG_THINGSBOARD_REQUEST_MAX_PATH_LENGTH];
-	char payload[CONFIG_COAP_CLIENT_MESSAGE_SIZE];
+	/* Payload buffer, allocated from one of the payload size classes. NULL,
+	 * when the request has been allocated without payload. */
+	char *payload;
+	/* Usable size of `payload` in bytes */
+	size_t payload_size;
+	/* Size class `payload` has been allocated from */
+	uint8_t payload_class;
+	/* Telemetry sent as CoAP NON message, freed once the CoAP client is done with it */
+	bool non_confirmable;
+	/* Optional delivery callback of telemetry requests */
+	thingsboard_delivery_callback_t delivery_cb;
+	void *delivery_user_data;
+	/* Number of timeseries entries carried by the request */
+	size_t ts_count;
+	/* Uptime in ms, when the request has been sent */
+	int64_t sent_at;
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+	/* Backlog record carried by this request, 0 if none */
+	uint32_t backlog_record;
+	/* Store the payload in the backlog, if it is not acknowledged */
+	bool backlog_persist;
+	/* Length of the encoded payload */
+	size_t payload_len;
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
+};
+
+/**
+ * CoAP paths, built once when the access token is known. Requests reference
+ * these directly.
+ */
+struct thingsboard_paths {
+	char attributes[CONFIG_THINGSBOARD_REQUEST_MAX_PATH_LENGTH];
+	char telemetry[CONFIG_THINGSBOARD_REQUEST_MAX_PATH_LENGTH];
+	char rpc[CONFIG_THINGSBOARD_REQUEST_MAX_PATH_LENGTH];
+	char firmware[CONFIG_THINGSBOARD_REQUEST_MAX_PATH_LENGTH];
 };
 
 enum thingsboard_state {
@@ -83,6 +116,8 @@ struct thingsboard_client {
 	const char *access_token;
 #endif /* CONFIG_THINGSBOARD_DTLS */
 
+	struct thingsboard_paths paths;
+
 	struct k_mutex lock;
 	thingsboard_attributes shared_attributes;
 
@@ -106,12 +141,31 @@ int thingsboard_cat_path(const char *in[], char *out, size_t out_len);
 /**
  * Allocate a `struct thingsboard_request` from Thingsbaord SDKs internal slab storage.
  *
+ * The payload buffer is taken from the smallest size class, which is able to
+ * hold `payload_size` bytes and has a free block left. Its actual size is
+ * stored in `payload_size` of the returned request.
+ *
+ * @param payload_size Minimum size of the payload buffer. Use 0 for requests
+ *                     without payload.
+ *
  * @return Pointer to allocated `struct thingsboard_request` or NULL, when no slab was free.
  */
-struct thingsboard_request *thingsboard_request_alloc(void);
+struct thingsboard_request *thingsboard_request_alloc(size_t payload_size);
+
+/**
+ * Move the payload of a request into a smaller size class, if possible.
+ *
+ * Used after encoding into a worst-case sized payload buffer, to release the
+ * large buffer as early as possible. The request is left untouched, when there
+ * is no smaller free block available.
+ *
+ * @param request Request to shrink
+ * @param len Amount of bytes used in the payload buffer
+ */
+void thingsboard_request_shrink(struct thingsboard_request *request, size_t len);
 
 /**
- * Free slab, previous allocated with `thingsboard_request_alloc()`.
+ * Free slab, previous allocated with `thingsboard_request_alloc()`, including its payload.
  *
  * @param request Pointer to `struct thingsboard_request` to be freed
  */
@@ -121,11 +175,12 @@ void thingsboard_request_free(struct thingsboard_request *request);
  * Send RPC client to server request to Thingsboard Instance.
  *
  * @param r RPC request to be sent
- * @param rpc_cb Callback called after successful execution of RPC
+ * @param rpc_cb Callback called after successful execution of RPC, with the
+ *               uptime in ms, when this request has been sent
  * @return 0 on success, negative on error
  */
 int thingsboard_send_rpc_request(thingsboard_rpc_request *r,
-				 void (*rpc_cb)(const uint8_t *payload, size_t len));
+				 void (*rpc_cb)(const uint8_t *payload, size_t len, int64_t sent_at));
 
 #ifdef CONFIG_THINGSBOARD_FOTA
 /**
@@ -271,6 +326,184 @@ void thingsboard_stop_time_sync(void);
 
 #endif /* CONFIG_THINGSBOARD_TIME */
 
+/**
+ * Send telemetry request with an already encoded payload.
+ *
+ * The request is freed, when it has been completed or sending failed. With
+ * `non_confirmable` set, it is completed without retransmissions, once the
+ * response arrived or the CoAP client stopped waiting for it.
+ *
+ * @param request Request, with `sz` bytes of encoded telemetry in its payload
+ * @param sz Length of the payload
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_send_telemetry_request(struct thingsboard_request *request, size_t sz);
+
+/**
+ * Serialize and send timeseries, without queueing.
+ *
+ * Same as `thingsboard_send_timeseries()`, but expects the client to be active
+ * and sends the data right away. All requests needed are allocated and
+ * encoded beforehand, so either all or none of the data is sent.
+ *
+ * @param ts array of `thingsboard_timeseries` to be send to Thingsboard
+ * @param ts_count amount of `thingsboard_timeseries` objects in `ts`
+ * @param confirmable send as CoAP CON messages, otherwise as NON messages
+ * @param persist store messages which are not acknowledged in the telemetry
+ *                backlog, needs CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+ * @param cb optional delivery callback, called for every message
+ * @param user_data passed to `cb`
+ * @param sent optional, set to the number of entries sent, also on -EIO
+ *
+ * @retval 0 success
+ * @retval -ENOMEM not enough free requests to send all data
+ * @retval -EMSGSIZE a single entry does not fit into one message
+ * @retval -EINVAL encoding failed
+ * @retval -EIO sending failed, the first `sent` entries have been sent
+ */
+int thingsboard_send_timeseries_direct(const thingsboard_timeseries *ts, size_t ts_count,
+				       bool confirmable, bool persist, thingsboard_delivery_callback_t cb,
+				       void *user_data, size_t *sent);
+
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_QUEUE
+/**
+ * Put timeseries entries into the telemetry queue.
+ *
+ * Entries are copied, including strings referenced by them. When the queue is
+ * full, entries are dropped according to the THINGSBOARD_TELEMETRY_QUEUE_DROP
+ * Kconfig choice.
+ *
+ * @param ts array of `thingsboard_timeseries` to be queued
+ * @param ts_count amount of `thingsboard_timeseries` objects in `ts`
+ *
+ * @retval 0 success
+ * @retval -ENOSPC queue is full, new entries have been dropped
+ * @retval -ENOMEM a string of an entry did not fit into its buffer
+ */
+int thingsboard_telemetry_queue_put(const thingsboard_timeseries *ts, size_t ts_count);
+
+/**
+ * Check for queued telemetry.
+ *
+ * @retval true when there is no queued telemetry
+ */
+bool thingsboard_telemetry_queue_is_empty(void);
+
+/**
+ * Get amount of queued telemetry entries.
+ *
+ * @return Amount of entries in the queue
+ */
+size_t thingsboard_telemetry_queue_count(void);
+
+/**
+ * Encode the oldest queued entries into one message.
+ *
+ * As many entries as fit into `buffer` are encoded as timeseries. The
+ * encoded entries are removed from the queue only if `commit` succeeds.
+ *
+ * @param buffer Byte array where to serialize the entries to
+ * @param len Length of `buffer`
+ * @param commit Called with the encoded message, returns 0 on success or
+ *               negative on error
+ *
+ * @return Amount of entries removed from the queue, negative on error
+ */
+int thingsboard_telemetry_queue_encode(char *buffer, size_t len,
+				       int (*commit)(const char *buffer, size_t len));
+
+/**
+ * Schedule sending of all queued telemetry.
+ */
+void thingsboard_telemetry_queue_drain(void);
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_QUEUE */
+
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+/**
+ * Load the persisted telemetry backlog from settings.
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_telemetry_backlog_init(void);
+
+/**
+ * Put timeseries entries into the telemetry backlog.
+ *
+ * Entries are staged in the telemetry queue. While the client is active, the
+ * queue is sent like without backlog. Otherwise, staged entries are written
+ * to flash in batches.
+ *
+ * @param ts array of `thingsboard_timeseries` to be stored
+ * @param ts_count amount of `thingsboard_timeseries` objects in `ts`
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_telemetry_backlog_put(const thingsboard_timeseries *ts, size_t ts_count);
+
+/**
+ * Write all staged entries to flash right away, e.g. before rebooting.
+ */
+void thingsboard_telemetry_backlog_flush(void);
+
+/**
+ * Schedule sending of all persisted records.
+ */
+void thingsboard_telemetry_backlog_send(void);
+
+/**
+ * Called when the response to a request carrying a backlog record, or to a
+ * request to be persisted, arrived.
+ *
+ * Records acknowledged or rejected with a 4.xx code are deleted, others are
+ * sent again later. The payload of a request to be persisted is stored as new
+ * record, unless it has been acknowledged or rejected.
+ *
+ * @param request Completed request, freed by the backlog
+ * @param result_code CoAP response code or negative error of the request
+ */
+void thingsboard_telemetry_backlog_done(struct thingsboard_request *request, int16_t result_code);
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_STORE
+/**
+ * Restore the shared attributes from settings.
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_attributes_store_init(void);
+
+/**
+ * Schedule storing the shared attributes. Multiple changes within
+ * `CONFIG_THINGSBOARD_ATTRIBUTES_STORE_DELAY_MS` are written at once.
+ */
+void thingsboard_attributes_store_changed(void);
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_STORE */
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_SNAPSHOT
+/**
+ * Publish the current shared attributes to readers of
+ * `thingsboard_get_attributes_snapshot()`.
+ *
+ * Must be called with the Thingsboard lock held.
+ */
+void thingsboard_attributes_snapshot_publish(void);
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_SNAPSHOT */
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_FETCH
+/**
+ * Fetch the shared attributes given in the configuration. Used instead of
+ * `thingsboard_client_subscribe_attributes()` when connecting, notifications
+ * are only observed once the application calls
+ * `thingsboard_observe_attributes()`.
+ *
+ * Must be called with the Thingsboard lock held.
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_attributes_fetch_on_connect(void);
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_FETCH */
+
 /**
  * Subscribe(observe) attributes notification.
  *
@@ -295,16 +528,151 @@ int thingsboard_client_unsubscribe_attributes(void);
  * `struct thingsboard_attributes_buffer`, which holds buffers for each string
  * entry in `thingsboard_attributes`.
  *
+ * Only attributes whose value differs from `current` are copied.
+ *
  * @param changes Changes/updates to be applied to `current`
  * @param current Current state, to be updated
  * @param buffer Buffer to store strings into. Only needed for JSON encoding
  * @param buffer_len Size of `buffer`
+ * @param mask Mask of `THINGSBOARD_ATTRIBUTES_MASK_WORDS` words, the fields that changed are
+ *             marked in it. May be NULL.
  *
- * @return Amount of attributes which have been copied to `current` or negative on error
+ * @return Amount of attributes which changed or negative on error
  */
 ssize_t thingsboard_attributes_update(thingsboard_attributes *changes,
 				      thingsboard_attributes *current, void *buffer,
-				      size_t buffer_len);
+				      size_t buffer_len, uint32_t *mask);
+
+/**
+ * Timestamps and versions of received attributes, decoded along with them.
+ * They only replace the metadata of the shared attributes, once the
+ * attributes have been applied. JSON carries no metadata, `mask` stays empty.
+ */
+struct thingsboard_attributes_meta {
+	/* Attributes with an entry in `meta`, deleted ones have an all zero entry */
+	uint32_t mask[THINGSBOARD_ATTRIBUTES_MASK_WORDS];
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF
+	struct thingsboard_attribute_meta meta[THINGSBOARD_ATTRIBUTES_FIELD_COUNT];
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF */
+};
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF
+/**
+ * Merge metadata of later received attributes into `dst`.
+ *
+ * @param dst Metadata to be updated
+ * @param src Metadata of the later attributes
+ */
+void thingsboard_attributes_meta_merge(struct thingsboard_attributes_meta *dst,
+				       const struct thingsboard_attributes_meta *src);
+
+/**
+ * Replace the metadata of the shared attributes by `meta`, for the attributes in its mask.
+ *
+ * Must be called with the Thingsboard lock held.
+ *
+ * @param meta Metadata of applied attributes
+ */
+void thingsboard_attributes_meta_commit(const struct thingsboard_attributes_meta *meta);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF */
+
+/**
+ * Apply received attributes to the shared attributes and notify everyone
+ * interested in them.
+ *
+ * Must be called with the Thingsboard lock held.
+ *
+ * @param attr Attributes received from Thingsboard
+ * @param deleted Mask of the attributes deleted by Thingsboard
+ * @param meta Metadata of `attr` and `deleted`, committed if they have been applied
+ */
+void thingsboard_attributes_apply(thingsboard_attributes *attr, const uint32_t *deleted,
+				  const struct thingsboard_attributes_meta *meta);
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_COALESCE
+/**
+ * Merge received attributes into the pending update, which is applied once
+ * no further attributes arrived for `CONFIG_THINGSBOARD_ATTRIBUTES_COALESCE_WINDOW_MS`.
+ *
+ * Must be called with the Thingsboard lock held.
+ *
+ * @param attr Attributes received from Thingsboard
+ * @param deleted Mask of the attributes deleted by Thingsboard
+ * @param meta Metadata of `attr` and `deleted`
+ */
+void thingsboard_attributes_coalesce(thingsboard_attributes *attr, const uint32_t *deleted,
+				     const struct thingsboard_attributes_meta *meta);
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_COALESCE */
+
+/**
+ * Delete attributes from `current`.
+ *
+ * @param current Current state, to be updated
+ * @param buffer Buffer holding the strings of `current`. Only needed for JSON encoding
+ * @param buffer_len Size of `buffer`
+ * @param fields Mask of the fields to be deleted
+ * @param mask Mask of `THINGSBOARD_ATTRIBUTES_MASK_WORDS` words, the fields that have been
+ *             deleted are marked in it. May be NULL.
+ *
+ * @return Amount of attributes which have been deleted or negative on error
+ */
+ssize_t thingsboard_attributes_delete(thingsboard_attributes *current, void *buffer,
+				      size_t buffer_len, const uint32_t *fields, uint32_t *mask);
+
+#ifdef CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES
+/**
+ * Update `thingsboard_client_attributes`, see `thingsboard_attributes_update()`.
+ *
+ * @param changes Attributes to be set
+ * @param current Current state, to be updated
+ * @param buffer Buffer holding the strings of `current`. Only needed for JSON encoding
+ * @param buffer_len Size of `buffer`
+ * @param mask Mask of `THINGSBOARD_CLIENT_ATTRIBUTES_MASK_WORDS` words, the fields that
+ *             changed are marked in it. May be NULL.
+ *
+ * @return Amount of attributes which have been changed or negative on error
+ */
+ssize_t thingsboard_client_attributes_update(const thingsboard_client_attributes *changes,
+					     thingsboard_client_attributes *current, void *buffer,
+					     size_t buffer_len, uint32_t *mask);
+
+/**
+ * Delete client side attributes from `current`, see `thingsboard_attributes_delete()`.
+ *
+ * @param current Current state, to be updated
+ * @param buffer Buffer holding the strings of `current`. Only needed for JSON encoding
+ * @param buffer_len Size of `buffer`
+ * @param fields Mask of the fields to be deleted
+ * @param mask Mask of `THINGSBOARD_CLIENT_ATTRIBUTES_MASK_WORDS` words, the fields that
+ *             have been deleted are marked in it. May be NULL.
+ *
+ * @return Amount of attributes which have been deleted or negative on error
+ */
+ssize_t thingsboard_client_attributes_delete(thingsboard_client_attributes *current, void *buffer,
+					     size_t buffer_len, const uint32_t *fields,
+					     uint32_t *mask);
+
+/**
+ * Encode `thingsboard_client_attributes` to Protobuf or JSON.
+ *
+ * @param v Attributes to be encoded, only attributes which are set are encoded
+ * @param buffer Buffer where encoded data will be written to
+ * @param len Size of `buffer`, set to the amount of bytes written
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_client_attributes_encode(const thingsboard_client_attributes *v, char *buffer,
+					 size_t *len);
+#endif /* CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES */
+
+/**
+ * Call all attribute subscriptions interested in the fields marked in `changed`.
+ *
+ * Must be called with the Thingsboard lock held.
+ *
+ * @param changed Mask of the fields which changed
+ */
+void thingsboard_attributes_dispatch(const uint32_t *changed);
 
 /**
  * Decode Protobuf or JSON payload to `thingsboard_attributes`.
@@ -315,10 +683,119 @@ ssize_t thingsboard_attributes_update(thingsboard_attributes *changes,
  * @param len Length of data given in `buffer`
  * @param v Pointer to `thingsboard_attributes` object, where decoded values
  *          will be placed into
+ * @param deleted Mask of `THINGSBOARD_ATTRIBUTES_MASK_WORDS` words, attributes
+ *                deleted by Thingsboard are marked in it
+ * @param meta Metadata of the decoded and deleted attributes, to be passed to
+ *             `thingsboard_attributes_apply()`
+ *
+ * @return 0 on success, negative on error
+ */
+int thingsboard_attributes_decode(const char *buffer, size_t len, thingsboard_attributes *v,
+				  uint32_t *deleted, struct thingsboard_attributes_meta *meta);
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE
+/**
+ * Incremental decoder of attribute notifications spanning several CoAP blocks.
+ *
+ * The notification is split into its top level members (JSON) or fields
+ * (Protobuf), which are decoded one by one as soon as they are complete. Only
+ * the member being received is buffered.
+ */
+struct thingsboard_attributes_stream {
+	/* Attributes decoded so far */
+	thingsboard_attributes attributes;
+	/* Attributes deleted so far */
+	uint32_t deleted[THINGSBOARD_ATTRIBUTES_MASK_WORDS];
+	/* Metadata of the attributes decoded and deleted so far */
+	struct thingsboard_attributes_meta meta;
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	/* Storage for the strings of `attributes` */
+	struct thingsboard_attributes_buffer buffer;
+	/* Nesting level of objects and arrays */
+	int depth;
+	bool in_string;
+	bool escape;
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	/* Part of the field being received */
+	uint8_t state;
+	/* Shift of the next byte of a varint */
+	uint8_t shift;
+	/* Remaining bytes of the field value */
+	size_t remaining;
+	/* Fields are decoded as `AttributeUpdateNotificationMsg` */
+	bool notification;
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	/* Offset of the next expected block */
+	size_t received;
+	/* First error, stops decoding */
+	int err;
+	/* Member or field being received */
+	size_t len;
+	char member[CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE_MEMBER_SIZE];
+};
+
+/**
+ * Start decoding a new notification.
+ *
+ * @param s Decoder state
+ */
+void thingsboard_attributes_stream_init(struct thingsboard_attributes_stream *s);
+
+/**
+ * Decode the next block of a notification.
+ *
+ * @param s Decoder state
+ * @param offset Offset of the block in the notification
+ * @param data Payload of the block
+ * @param len Length of `data`
+ *
+ * @return 0 on success, negative on error. Once an error occurred, all
+ *         further blocks are rejected with it.
+ */
+int thingsboard_attributes_stream_feed(struct thingsboard_attributes_stream *s, size_t offset,
+				       const char *data, size_t len);
+
+/**
+ * Finish decoding after the last block. On success, `s->attributes` and
+ * `s->deleted` hold the decoded notification.
+ *
+ * @param s Decoder state
+ *
+ * @return 0 on success, negative on error or when the notification is incomplete
+ */
+int thingsboard_attributes_stream_finish(struct thingsboard_attributes_stream *s);
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE */
+
+/**
+ * Decode the response to fetching attributes by key to `thingsboard_attributes`.
+ *
+ * Only the shared attributes are decoded, client attributes are ignored.
+ * Might reference parts of `buffer` in the decoded structure.
+ *
+ * @param buffer Buffer from which to read data to be decoded.
+ * @param len Length of data given in `buffer`
+ * @param v Pointer to `thingsboard_attributes` object, where decoded values
+ *          will be placed into
+ * @param meta Metadata of the decoded attributes, to be passed to
+ *             `thingsboard_attributes_apply()`
  *
  * @return 0 on success, negative on error
  */
-int thingsboard_attributes_decode(const char *buffer, size_t len, thingsboard_attributes *v);
+int thingsboard_attributes_response_decode(const char *buffer, size_t len,
+					   thingsboard_attributes *v,
+					   struct thingsboard_attributes_meta *meta);
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF
+/**
+ * Get the key of a shared attribute, as used by Thingsboard. For JSON, this
+ * is generated along with `thingsboard_attributes`.
+ *
+ * @param field Attribute to get the key of
+ *
+ * @return Key of the attribute or NULL, if `field` is invalid
+ */
+const char *thingsboard_attributes_field_name(enum thingsboard_attributes_field field);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF */
 
 /**
  * Decode Protobuf or JSON payload to `thingsboard_rpc_response`.
@@ -0,0 +1,164 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <thingsboard.h>
+
+#include "tb_internal.h"
+
+LOG_MODULE_REGISTER(tb_telemetry_aggregator, CONFIG_THINGSBOARD_LOG_LEVEL);
+
+#define MAX_ENTRIES CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR_MAX_ENTRIES
+#define FLUSH_BYTES                                                                                \
+	(CONFIG_COAP_CLIENT_MESSAGE_SIZE * CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR_FLUSH_PERCENT / 100)
+
+/* Recorded samples of the current batch */
+static struct {
+	thingsboard_timeseries entries[MAX_ENTRIES];
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	/* Storage for strings referenced by `entries`, same index */
+	struct thingsboard_telemetry_buffer buffers[MAX_ENTRIES];
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	size_t count;
+	/* Encoded size of the batch */
+	size_t len;
+	/* Used to measure the encoded size of a new sample */
+	char scratch[CONFIG_COAP_CLIENT_MESSAGE_SIZE];
+} batch;
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+/* Room for the zero terminator written by the encoder */
+#define BATCH_MAX_LEN (CONFIG_COAP_CLIENT_MESSAGE_SIZE - 1)
+
+/* Encoded alone, a sample is wrapped into brackets. In a batch, a comma separates it instead. */
+static size_t batch_len_add(size_t batch_len, size_t sample_len)
+{
+	return batch_len == 0 ? sample_len : batch_len + sample_len - 1;
+}
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+#define BATCH_MAX_LEN CONFIG_COAP_CLIENT_MESSAGE_SIZE
+
+/* The list is the concatenation of its entries */
+static size_t batch_len_add(size_t batch_len, size_t sample_len)
+{
+	return batch_len + sample_len;
+}
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+static K_MUTEX_DEFINE(batch_lock);
+
+static void batch_timeout_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(batch_timeout_work, batch_timeout_work_fn);
+
+static int batch_store(size_t idx, const thingsboard_timeseries *ts)
+{
+	thingsboard_timeseries *entry = &batch.entries[idx];
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	*entry = (thingsboard_timeseries){
+		.ts = ts->ts,
+		.has_values = ts->has_values,
+	};
+
+	ssize_t ret = thingsboard_telemetry_update_with_buffer(&ts->values, &entry->values,
+							       &batch.buffers[idx], NULL);
+	if (ret < 0) {
+		return -ENOMEM;
+	}
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	*entry = *ts;
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+	return 0;
+}
+
+static int batch_send_locked(void)
+{
+	size_t count = batch.count;
+
+	batch.count = 0;
+	batch.len = 0;
+
+	(void)k_work_cancel_delayable(&batch_timeout_work);
+
+	if (count == 0) {
+		return 0;
+	}
+
+	LOG_DBG("Sending %zu aggregated samples", count);
+
+	int err = thingsboard_send_timeseries(batch.entries, count);
+	if (err < 0) {
+		LOG_WRN("Failed to send aggregated telemetry, dropping %zu samples: %d", count,
+			err);
+	}
+
+	return err;
+}
+
+int thingsboard_record_telemetry(const thingsboard_telemetry *telemetry)
+{
+	int err = 0;
+	size_t len = sizeof(batch.scratch);
+	size_t fitting = 1;
+
+	__ASSERT_NO_MSG(telemetry);
+
+	thingsboard_timeseries ts = {
+		.ts = thingsboard_time_msec(),
+		.has_values = true,
+		.values = *telemetry,
+	};
+
+	(void)k_mutex_lock(&batch_lock, K_FOREVER);
+
+	/* Only the new sample is encoded, the size of the batch is tracked incrementally */
+	err = thingsboard_timeseries_encode(&ts, &fitting, batch.scratch, &len);
+	if (err < 0 || fitting == 0) {
+		LOG_ERR("Dropping sample, too large for one message");
+		err = err < 0 ? err : -EMSGSIZE;
+		goto out;
+	}
+
+	size_t batch_len = batch_len_add(batch.len, len);
+	if (batch.count > 0 && batch_len > BATCH_MAX_LEN) {
+		/* The new sample does not fit anymore, it starts the next batch */
+		err = batch_send_locked();
+		batch_len = len;
+	}
+
+	int ret = batch_store(batch.count, &ts);
+	if (ret < 0) {
+		err = ret;
+		goto out;
+	}
+	batch.count++;
+	batch.len = batch_len;
+
+	if (batch.len >= FLUSH_BYTES || batch.count >= MAX_ENTRIES) {
+		err = batch_send_locked();
+	} else if (batch.count == 1) {
+		(void)k_work_schedule(&batch_timeout_work,
+				      K_MSEC(CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR_MAX_LATENCY_MS));
+	}
+
+out:
+	(void)k_mutex_unlock(&batch_lock);
+
+	return err;
+}
+
+int thingsboard_flush_telemetry(void)
+{
+	(void)k_mutex_lock(&batch_lock, K_FOREVER);
+
+	int err = batch_send_locked();
+
+	(void)k_mutex_unlock(&batch_lock);
+
+	return err;
+}
+
+static void batch_timeout_work_fn(struct k_work *work)
+{
+	(void)thingsboard_flush_telemetry();
+}
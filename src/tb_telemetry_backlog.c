@@ -0,0 +1,472 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include "tb_internal.h"
+
+LOG_MODULE_REGISTER(tb_telemetry_backlog, CONFIG_THINGSBOARD_LOG_LEVEL);
+
+/*
+ * Telemetry is staged in the telemetry queue. While connected, it is sent
+ * right away and only messages which are not acknowledged are written to
+ * settings. Otherwise, staged entries are encoded into messages, which are
+ * written as one record each. A record is deleted, as soon as the server
+ * acknowledged or rejected the request carrying it. This way, flash is
+ * written at most once per message worth of data, or once per flush interval.
+ */
+
+#define THINGSBOARD_BACKLOG_SETTINGS_KEY "thingsboard/backlog"
+#define RECORD_KEY_LEN                   sizeof(THINGSBOARD_BACKLOG_SETTINGS_KEY "/00000000")
+
+#define MAX_RECORDS CONFIG_THINGSBOARD_TELEMETRY_BACKLOG_MAX_RECORDS
+
+struct backlog_record {
+	/* Sequence number, part of the settings key. 0 marks an unused slot. */
+	uint32_t seq;
+	bool in_flight;
+};
+
+enum backlog_result {
+	BACKLOG_DELIVERED,
+	/* The server will not accept the data, sending it again is pointless */
+	BACKLOG_REJECTED,
+	/* No response, or a temporary error */
+	BACKLOG_RETRY,
+};
+
+struct backlog_done {
+	/* Record carried by the request, 0 for a request to be persisted */
+	uint32_t seq;
+	enum backlog_result result;
+	/* Request to be persisted, NULL for records */
+	struct thingsboard_request *request;
+};
+
+static struct {
+	struct backlog_record records[MAX_RECORDS];
+	uint32_t next_seq;
+	/* Uptime in ms, when staged entries have to be written at latest. 0 if not set. */
+	int64_t flush_deadline;
+	/* Uptime in ms, when sending records should be retried. 0 if not set. */
+	int64_t retry_at;
+	bool reset_in_flight;
+	char buffer[CONFIG_COAP_CLIENT_MESSAGE_SIZE];
+} backlog = {
+	.next_seq = 1,
+};
+
+static K_MUTEX_DEFINE(backlog_lock);
+
+/* Responses are reported from the CoAP client thread, process them in the work item */
+K_MSGQ_DEFINE(backlog_done_msgq, sizeof(struct backlog_done), CONFIG_COAP_CLIENT_MAX_REQUESTS * 2,
+	      4);
+
+static void backlog_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(backlog_work, backlog_work_fn);
+
+static void record_key(uint32_t seq, char key[RECORD_KEY_LEN])
+{
+	snprintf(key, RECORD_KEY_LEN, THINGSBOARD_BACKLOG_SETTINGS_KEY "/%08" PRIx32, seq);
+}
+
+static struct backlog_record *find_record(uint32_t seq)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(backlog.records); i++) {
+		if (backlog.records[i].seq == seq) {
+			return &backlog.records[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct backlog_record *find_oldest_record(bool in_flight)
+{
+	struct backlog_record *oldest = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(backlog.records); i++) {
+		struct backlog_record *r = &backlog.records[i];
+
+		if (r->seq == 0 || r->in_flight != in_flight) {
+			continue;
+		}
+
+		if (oldest == NULL || r->seq < oldest->seq) {
+			oldest = r;
+		}
+	}
+
+	return oldest;
+}
+
+static void delete_record(struct backlog_record *r)
+{
+	char key[RECORD_KEY_LEN];
+
+	record_key(r->seq, key);
+
+	int err = settings_delete(key);
+	if (err < 0) {
+		LOG_WRN("Failed to delete backlog record %s: %d", key, err);
+	}
+
+	*r = (struct backlog_record){0};
+}
+
+static int backlog_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+				void *cb_arg)
+{
+	char *end;
+	unsigned long seq = strtoul(name, &end, 16);
+
+	if (end == name || *end != '\0' || seq == 0 || seq > UINT32_MAX) {
+		return -ENOENT;
+	}
+
+	if (len == 0) {
+		/* Deleted record */
+		return 0;
+	}
+
+	(void)k_mutex_lock(&backlog_lock, K_FOREVER);
+
+	/* Settings might be loaded multiple times, e.g. by provisioning */
+	if (find_record(seq) == NULL) {
+		struct backlog_record *r = find_record(0);
+		if (r != NULL) {
+			r->seq = seq;
+		} else {
+			LOG_WRN("Too many backlog records, ignoring record %08lx", seq);
+		}
+	}
+
+	if (seq >= backlog.next_seq) {
+		backlog.next_seq = seq + 1;
+	}
+
+	(void)k_mutex_unlock(&backlog_lock);
+
+	return 0;
+}
+
+static SETTINGS_STATIC_HANDLER_DEFINE(backlog_settings_conf, THINGSBOARD_BACKLOG_SETTINGS_KEY, NULL,
+				      backlog_settings_set, NULL, NULL);
+
+struct record_read_ctx {
+	char *buffer;
+	size_t size;
+	ssize_t len;
+};
+
+static int record_read_cb(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg,
+			  void *param)
+{
+	struct record_read_ctx *ctx = param;
+
+	if (len > ctx->size) {
+		ctx->len = -ENOMEM;
+		return 0;
+	}
+
+	ctx->len = read_cb(cb_arg, ctx->buffer, len);
+
+	return 0;
+}
+
+static int backlog_commit(const char *buffer, size_t len)
+{
+	char key[RECORD_KEY_LEN];
+
+	struct backlog_record *r = find_record(0);
+	if (r == NULL) {
+		if (IS_ENABLED(CONFIG_THINGSBOARD_TELEMETRY_QUEUE_DROP_NEWEST)) {
+			return -ENOSPC;
+		}
+
+		r = find_oldest_record(false);
+		if (r == NULL) {
+			return -ENOSPC;
+		}
+
+		LOG_WRN("Telemetry backlog full, dropping oldest record");
+		delete_record(r);
+	}
+
+	record_key(backlog.next_seq, key);
+
+	int err = settings_save_one(key, buffer, len);
+	if (err < 0) {
+		LOG_ERR("Failed to write backlog record %s: %d", key, err);
+		return err;
+	}
+
+	LOG_DBG("Stored backlog record %s, %zu B", key, len);
+
+	r->seq = backlog.next_seq;
+	r->in_flight = false;
+	backlog.next_seq++;
+
+	return 0;
+}
+
+static void backlog_flush_locked(void)
+{
+	int ret;
+
+	do {
+		ret = thingsboard_telemetry_queue_encode(backlog.buffer, sizeof(backlog.buffer),
+							 backlog_commit);
+	} while (ret > 0 || ret == -EMSGSIZE);
+
+	if (ret < 0) {
+		LOG_WRN("Failed to write staged telemetry: %d", ret);
+	}
+
+	backlog.flush_deadline = 0;
+}
+
+static void backlog_send_locked(void)
+{
+	size_t in_flight = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(backlog.records); i++) {
+		if (backlog.records[i].seq != 0 && backlog.records[i].in_flight) {
+			in_flight++;
+		}
+	}
+
+	while (in_flight < CONFIG_THINGSBOARD_TELEMETRY_BACKLOG_MAX_IN_FLIGHT &&
+	       thingsboard_is_active()) {
+		char key[RECORD_KEY_LEN];
+
+		struct backlog_record *r = find_oldest_record(false);
+		if (r == NULL) {
+			return;
+		}
+
+		struct thingsboard_request *request =
+			thingsboard_request_alloc(CONFIG_COAP_CLIENT_MESSAGE_SIZE);
+		if (request == NULL) {
+			goto retry;
+		}
+
+		struct record_read_ctx ctx = {
+			.buffer = request->payload,
+			.size = request->payload_size,
+		};
+
+		record_key(r->seq, key);
+		int err = settings_load_subtree_direct(key, record_read_cb, &ctx);
+		if (err < 0 || ctx.len <= 0) {
+			LOG_ERR("Failed to read backlog record %s, dropping it", key);
+			thingsboard_request_free(request);
+			delete_record(r);
+			continue;
+		}
+
+		thingsboard_request_shrink(request, ctx.len);
+		request->backlog_record = r->seq;
+		r->in_flight = true;
+
+		err = thingsboard_send_telemetry_request(request, ctx.len);
+		if (err < 0) {
+			r->in_flight = false;
+			goto retry;
+		}
+
+		in_flight++;
+	}
+
+	return;
+
+retry:
+	backlog.retry_at = k_uptime_get() + CONFIG_THINGSBOARD_TELEMETRY_QUEUE_RETRY_INTERVAL_MS;
+}
+
+static void backlog_work_fn(struct k_work *work)
+{
+	struct backlog_done done;
+	int64_t now = k_uptime_get();
+	int64_t next = 0;
+
+	(void)k_mutex_lock(&backlog_lock, K_FOREVER);
+
+	while (k_msgq_get(&backlog_done_msgq, &done, K_NO_WAIT) == 0) {
+		if (done.request != NULL) {
+			/* Only requests to be sent again are passed on */
+			int err = backlog_commit(done.request->payload, done.request->payload_len);
+			if (err < 0) {
+				LOG_WRN("Failed to store unacknowledged telemetry: %d", err);
+			}
+			thingsboard_request_free(done.request);
+			backlog.retry_at = now + CONFIG_THINGSBOARD_TELEMETRY_QUEUE_RETRY_INTERVAL_MS;
+			continue;
+		}
+
+		struct backlog_record *r = find_record(done.seq);
+		if (r == NULL) {
+			/* Already deleted, e.g. sent twice after reconnecting */
+			continue;
+		}
+
+		switch (done.result) {
+		case BACKLOG_REJECTED:
+			LOG_WRN("Backlog record %08" PRIx32 " rejected, dropping it", done.seq);
+			delete_record(r);
+			break;
+		case BACKLOG_DELIVERED:
+			delete_record(r);
+			break;
+		case BACKLOG_RETRY:
+			r->in_flight = false;
+			backlog.retry_at = now + CONFIG_THINGSBOARD_TELEMETRY_QUEUE_RETRY_INTERVAL_MS;
+			break;
+		}
+	}
+
+	if (backlog.reset_in_flight) {
+		/* Responses to requests sent before reconnecting might never arrive */
+		for (size_t i = 0; i < ARRAY_SIZE(backlog.records); i++) {
+			backlog.records[i].in_flight = false;
+		}
+		backlog.reset_in_flight = false;
+	}
+
+	size_t staged = thingsboard_telemetry_queue_count();
+	if (staged > 0 && backlog.flush_deadline == 0) {
+		backlog.flush_deadline =
+			now + CONFIG_THINGSBOARD_TELEMETRY_BACKLOG_FLUSH_INTERVAL_SECONDS * MSEC_PER_SEC;
+	}
+
+	if (staged >= CONFIG_THINGSBOARD_TELEMETRY_BACKLOG_BATCH_SIZE ||
+	    (staged > 0 && now >= backlog.flush_deadline)) {
+		backlog_flush_locked();
+	}
+
+	if (backlog.retry_at == 0 || now >= backlog.retry_at) {
+		backlog.retry_at = 0;
+		backlog_send_locked();
+	}
+
+	if (backlog.flush_deadline != 0) {
+		next = backlog.flush_deadline;
+	}
+	if (backlog.retry_at != 0 && (next == 0 || backlog.retry_at < next)) {
+		next = backlog.retry_at;
+	}
+
+	(void)k_mutex_unlock(&backlog_lock);
+
+	if (next != 0) {
+		(void)k_work_reschedule(k_work_delayable_from_work(work),
+					K_MSEC(MAX(next - now, 0)));
+	}
+}
+
+int thingsboard_telemetry_backlog_put(const thingsboard_timeseries *ts, size_t ts_count)
+{
+	bool was_empty = thingsboard_telemetry_queue_is_empty();
+
+	int err = thingsboard_telemetry_queue_put(ts, ts_count);
+
+	/* Either start the flush interval or write a full batch */
+	if (was_empty || thingsboard_telemetry_queue_count() >=
+				 CONFIG_THINGSBOARD_TELEMETRY_BACKLOG_BATCH_SIZE) {
+		(void)k_work_reschedule(&backlog_work, K_NO_WAIT);
+	}
+
+	return err;
+}
+
+void thingsboard_telemetry_backlog_flush(void)
+{
+	(void)k_mutex_lock(&backlog_lock, K_FOREVER);
+	backlog_flush_locked();
+	(void)k_mutex_unlock(&backlog_lock);
+}
+
+void thingsboard_telemetry_backlog_send(void)
+{
+	(void)k_mutex_lock(&backlog_lock, K_FOREVER);
+	backlog.reset_in_flight = true;
+	backlog.retry_at = 0;
+	(void)k_mutex_unlock(&backlog_lock);
+
+	(void)k_work_reschedule(&backlog_work, K_NO_WAIT);
+}
+
+static enum backlog_result backlog_result(int16_t result_code)
+{
+	if (result_code < 0) {
+		/* Timeout or transport error */
+		return BACKLOG_RETRY;
+	}
+
+	switch (result_code >> 5) {
+	case 2:
+		return BACKLOG_DELIVERED;
+	case 4:
+		return BACKLOG_REJECTED;
+	default:
+		return BACKLOG_RETRY;
+	}
+}
+
+void thingsboard_telemetry_backlog_done(struct thingsboard_request *request, int16_t result_code)
+{
+	struct backlog_done done = {
+		.seq = request->backlog_record,
+		.result = backlog_result(result_code),
+	};
+
+	if (done.seq == 0) {
+		if (done.result == BACKLOG_REJECTED) {
+			LOG_WRN("Telemetry rejected with code %d.%02d, dropping it",
+				result_code >> 5, result_code & 0x1f);
+		}
+		if (done.result != BACKLOG_RETRY) {
+			thingsboard_request_free(request);
+			return;
+		}
+
+		/* Writing to flash is left to the work item, it keeps the payload until then */
+		done.request = request;
+	} else {
+		thingsboard_request_free(request);
+	}
+
+	if (k_msgq_put(&backlog_done_msgq, &done, K_NO_WAIT) < 0) {
+		if (done.request != NULL) {
+			LOG_WRN("Failed to persist unacknowledged telemetry, dropping it");
+			thingsboard_request_free(done.request);
+		} else {
+			/* The record will be sent again, after reconnecting */
+			LOG_WRN("Dropped response for backlog record %08" PRIx32, done.seq);
+		}
+		return;
+	}
+
+	(void)k_work_reschedule(&backlog_work, K_NO_WAIT);
+}
+
+int thingsboard_telemetry_backlog_init(void)
+{
+	int err;
+
+	err = settings_subsys_init();
+	if (err < 0) {
+		LOG_ERR("Failed to initialize settings subsystem: %d", err);
+		return err;
+	}
+
+	err = settings_load_subtree(THINGSBOARD_BACKLOG_SETTINGS_KEY);
+	if (err < 0) {
+		LOG_ERR("Failed to load telemetry backlog: %d", err);
+		return err;
+	}
+
+	return 0;
+}
@@ -0,0 +1,203 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <thingsboard.h>
+
+#include "tb_internal.h"
+
+LOG_MODULE_REGISTER(tb_telemetry_blockwise, CONFIG_THINGSBOARD_LOG_LEVEL);
+
+#define BLOCK_SIZE CONFIG_THINGSBOARD_TELEMETRY_BLOCKWISE_BLOCK_SIZE
+/* Block size exponent of the Block1 option, the size is 2^(SZX + 4) bytes */
+#define BLOCK_SZX  (LOG2(BLOCK_SIZE) - 4)
+/* Block numbers are limited to 20 bits */
+#define MAX_BLOCKS BIT(20)
+
+BUILD_ASSERT(IS_POWER_OF_TWO(BLOCK_SIZE), "Block size has to be a power of two");
+BUILD_ASSERT(BLOCK_SIZE <= CONFIG_COAP_CLIENT_MESSAGE_SIZE,
+	     "Block size exceeds CONFIG_COAP_CLIENT_MESSAGE_SIZE");
+/* Larger payloads would be split again by the CoAP client, using its own Block1 option */
+BUILD_ASSERT(BLOCK_SIZE <= CONFIG_COAP_CLIENT_BLOCK_SIZE,
+	     "Block size exceeds CONFIG_COAP_CLIENT_BLOCK_SIZE");
+
+static struct {
+	/* Source of the running upload, claimed atomically to start one */
+	atomic_ptr_t source;
+	/* Payload of the block being sent. The CoAP client copies it, when sending. */
+	uint8_t block[BLOCK_SIZE];
+	/* Block1 and Size1 options */
+	struct coap_client_option options[2];
+	/* Number of the block in flight */
+	uint32_t num;
+	/* Further blocks follow the one in flight */
+	bool more;
+	/* The last block has been acknowledged */
+	bool end;
+	/* First error, stops the upload */
+	atomic_t err;
+} upload;
+
+static void upload_work_fn(struct k_work *work);
+static K_WORK_DEFINE(upload_work, upload_work_fn);
+
+/* Encode an uint option in as few bytes as possible, 0 has no bytes at all */
+static struct coap_client_option option_uint(uint16_t code, uint32_t value)
+{
+	struct coap_client_option option = {.code = code};
+
+	for (uint32_t v = value; v != 0; v >>= 8) {
+		option.len++;
+	}
+
+	for (uint8_t i = 0; i < option.len; i++) {
+		option.value[i] = value >> (8 * (option.len - 1 - i));
+	}
+
+	return option;
+}
+
+static void upload_handle_response(int16_t result_code, size_t offset, const uint8_t *payload,
+				   size_t len, bool last_block, void *user_data)
+{
+	if (!last_block) {
+		return;
+	}
+
+	/*
+	 * The CoAP client does not pass the response options, so the Block1 option of a 2.31
+	 * response can not be checked. A server preferring smaller blocks than BLOCK_SIZE is only
+	 * detected, when it rejects the block with 4.13.
+	 */
+	if (result_code < 0) {
+		LOG_ERR("Block %u of telemetry upload failed: %d", upload.num, result_code);
+		(void)atomic_cas(&upload.err, 0, result_code);
+	} else if (result_code == COAP_RESPONSE_CODE_REQUEST_TOO_LARGE) {
+		LOG_ERR("Server does not accept blocks of %u B", BLOCK_SIZE);
+		(void)atomic_cas(&upload.err, 0, -EMSGSIZE);
+	} else if (upload.more && result_code == COAP_RESPONSE_CODE_CONTINUE) {
+		upload.num++;
+	} else if (!upload.more && (result_code >> 5) == 2) {
+		upload.end = true;
+	} else {
+		LOG_ERR("Block %u of telemetry upload rejected with code %d", upload.num,
+			result_code);
+		(void)atomic_cas(&upload.err, 0, -EBADMSG);
+	}
+
+	(void)k_work_submit(&upload_work);
+}
+
+/* Read and send the block `upload.num` */
+static int upload_send_block(void)
+{
+	const struct thingsboard_telemetry_source *source = atomic_ptr_get(&upload.source);
+	size_t offset = (size_t)upload.num * BLOCK_SIZE;
+	size_t len = MIN(BLOCK_SIZE, source->size - offset);
+	uint8_t num_options = 0;
+
+	int ret = source->read(offset, upload.block, len, source->user_data);
+	if (ret < 0) {
+		return ret;
+	}
+	if ((size_t)ret != len) {
+		return -EIO;
+	}
+
+	upload.more = offset + len < source->size;
+
+	/* Payloads fitting into a single block are sent as a regular request */
+	if (source->size > BLOCK_SIZE) {
+		uint32_t block1 = (upload.num << 4) | (upload.more ? BIT(3) : 0) | BLOCK_SZX;
+
+		upload.options[num_options++] = option_uint(COAP_OPTION_BLOCK1, block1);
+		if (upload.num == 0) {
+			upload.options[num_options++] =
+				option_uint(COAP_OPTION_SIZE1, source->size);
+		}
+	}
+
+	struct coap_client_request coap_request = {
+		.payload = upload.block,
+		.len = len,
+		.confirmable = true,
+		.method = COAP_METHOD_POST,
+		.fmt = THINGSBOARD_DEFAULT_CONTENT_FORMAT,
+		.path = thingsboard_client.paths.telemetry,
+		.options = upload.options,
+		.num_options = num_options,
+		.cb = upload_handle_response,
+	};
+
+	int err = coap_client_req(&thingsboard_client.coap_client, thingsboard_client.server_socket,
+				  (struct sockaddr *)thingsboard_client.server_address,
+				  &coap_request, NULL);
+	if (err < 0) {
+		LOG_ERR("Failed to send block %u of telemetry upload: %d", upload.num, err);
+		return -EIO;
+	}
+
+	LOG_DBG("Sent block %u of telemetry upload, %zu B", upload.num, len);
+
+	return 0;
+}
+
+static void upload_work_fn(struct k_work *work)
+{
+	if (atomic_ptr_get(&upload.source) == NULL) {
+		return;
+	}
+
+	int err = atomic_get(&upload.err);
+
+	if (err == 0 && !upload.end) {
+		err = thingsboard_is_active() ? upload_send_block() : -EAGAIN;
+		if (err == 0) {
+			/* The response submits the work again */
+			return;
+		}
+	}
+
+	const struct thingsboard_telemetry_source *source = atomic_ptr_get(&upload.source);
+
+	/* Release the upload first, so `done` can start the next one */
+	(void)atomic_ptr_clear(&upload.source);
+
+	if (err < 0) {
+		LOG_ERR("Telemetry upload failed: %d", err);
+	}
+
+	if (source->done != NULL) {
+		source->done(err, source->user_data);
+	}
+}
+
+int thingsboard_send_telemetry_blockwise(const struct thingsboard_telemetry_source *source)
+{
+	__ASSERT_NO_MSG(source);
+	__ASSERT_NO_MSG(source->read);
+
+	if (source->size == 0 || DIV_ROUND_UP(source->size, BLOCK_SIZE) > MAX_BLOCKS) {
+		return -EINVAL;
+	}
+
+	if (!thingsboard_is_active()) {
+		return -EAGAIN;
+	}
+
+	if (!atomic_ptr_cas(&upload.source, NULL, (atomic_ptr_val_t)source)) {
+		return -EBUSY;
+	}
+
+	/* The work is not submitted while no upload is running */
+	upload.num = 0;
+	upload.more = false;
+	upload.end = false;
+	atomic_set(&upload.err, 0);
+
+	(void)k_work_submit(&upload_work);
+
+	return 0;
+}
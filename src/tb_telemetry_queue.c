@@ -0,0 +1,216 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "tb_internal.h"
+
+LOG_MODULE_REGISTER(tb_telemetry_queue, CONFIG_THINGSBOARD_LOG_LEVEL);
+
+#define QUEUE_SIZE  CONFIG_THINGSBOARD_TELEMETRY_QUEUE_SIZE
+/* One slot more than entries, so a new entry can be stored before the oldest one is dropped */
+#define QUEUE_SLOTS (QUEUE_SIZE + 1)
+
+/* Ring buffer of timeseries entries. The entries are kept in a plain array, so
+ * that consecutive entries can be passed to `thingsboard_send_timeseries_direct()`
+ * without copying them again.
+ */
+static struct {
+	thingsboard_timeseries entries[QUEUE_SLOTS];
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	/* Storage for strings referenced by `entries`, same index */
+	struct thingsboard_telemetry_buffer buffers[QUEUE_SLOTS];
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	size_t head;
+	size_t tail;
+	size_t count;
+} queue;
+
+static K_MUTEX_DEFINE(queue_lock);
+
+static void queue_drain_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(queue_drain_work, queue_drain_work_fn);
+
+static void queue_pop(size_t count)
+{
+	__ASSERT_NO_MSG(count <= queue.count);
+
+	queue.tail = (queue.tail + count) % QUEUE_SLOTS;
+	queue.count -= count;
+}
+
+static int queue_push(const thingsboard_timeseries *ts)
+{
+	thingsboard_timeseries *entry = &queue.entries[queue.head];
+
+	/* The slot at `head` is always free, a full queue still has the spare slot */
+	__ASSERT_NO_MSG(queue.count < QUEUE_SLOTS);
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	*entry = (thingsboard_timeseries){
+		.ts = ts->ts,
+		.has_values = ts->has_values,
+	};
+
+	ssize_t ret = thingsboard_telemetry_update_with_buffer(&ts->values, &entry->values,
+							       &queue.buffers[queue.head], NULL);
+	if (ret < 0) {
+		return -ENOMEM;
+	}
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	*entry = *ts;
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+	queue.head = (queue.head + 1) % QUEUE_SLOTS;
+	queue.count++;
+
+	return 0;
+}
+
+int thingsboard_telemetry_queue_put(const thingsboard_timeseries *ts, size_t ts_count)
+{
+	size_t dropped = 0;
+	int err = 0;
+
+	__ASSERT_NO_MSG(ts);
+
+	(void)k_mutex_lock(&queue_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ts_count; i++) {
+		bool full = queue.count == QUEUE_SIZE;
+
+		if (full && IS_ENABLED(CONFIG_THINGSBOARD_TELEMETRY_QUEUE_DROP_NEWEST)) {
+			err = -ENOSPC;
+			break;
+		}
+
+		int ret = queue_push(&ts[i]);
+		if (ret < 0) {
+			LOG_WRN("Failed to queue telemetry: %d", ret);
+			err = ret;
+			continue;
+		}
+
+		/* Only drop the oldest entry, once the new one has been stored */
+		if (full) {
+			queue_pop(1);
+			dropped++;
+		}
+	}
+
+	(void)k_mutex_unlock(&queue_lock);
+
+	if (err == -ENOSPC) {
+		LOG_WRN("Telemetry queue full, dropped newest entries");
+	} else if (dropped > 0) {
+		LOG_WRN("Telemetry queue full, dropped %zu oldest entries", dropped);
+	}
+
+	return err;
+}
+
+bool thingsboard_telemetry_queue_is_empty(void)
+{
+	return thingsboard_telemetry_queue_count() == 0;
+}
+
+size_t thingsboard_telemetry_queue_count(void)
+{
+	(void)k_mutex_lock(&queue_lock, K_FOREVER);
+
+	size_t count = queue.count;
+
+	(void)k_mutex_unlock(&queue_lock);
+
+	return count;
+}
+
+int thingsboard_telemetry_queue_encode(char *buffer, size_t len,
+				       int (*commit)(const char *buffer, size_t len))
+{
+	int err;
+
+	(void)k_mutex_lock(&queue_lock, K_FOREVER);
+
+	/* Only consecutive entries can be encoded at once, so stop at the end of the ring */
+	size_t n = MIN(queue.count, QUEUE_SLOTS - queue.tail);
+	if (n == 0) {
+		err = 0;
+		goto out;
+	}
+
+	err = thingsboard_timeseries_encode(&queue.entries[queue.tail], &n, buffer, &len);
+	if (err < 0) {
+		goto out;
+	}
+
+	if (n == 0) {
+		LOG_ERR("Dropping queued entry, too large for one message");
+		queue_pop(1);
+		err = -EMSGSIZE;
+		goto out;
+	}
+
+	err = commit(buffer, len);
+	if (err < 0) {
+		goto out;
+	}
+
+	queue_pop(n);
+	err = n;
+
+out:
+	(void)k_mutex_unlock(&queue_lock);
+
+	return err;
+}
+
+void thingsboard_telemetry_queue_drain(void)
+{
+	(void)k_work_reschedule(&queue_drain_work, K_NO_WAIT);
+}
+
+static void queue_drain_work_fn(struct k_work *work)
+{
+	size_t chunk = QUEUE_SIZE;
+
+	(void)k_mutex_lock(&queue_lock, K_FOREVER);
+
+	while (queue.count > 0 && thingsboard_is_active()) {
+		/* Only consecutive entries can be sent at once, so stop at the end of the ring */
+		size_t n = MIN(MIN(queue.count, QUEUE_SLOTS - queue.tail), chunk);
+		size_t sent = 0;
+
+		/* With the backlog, messages which are not acknowledged are persisted */
+		int err = thingsboard_send_timeseries_direct(
+			&queue.entries[queue.tail], n, true,
+			IS_ENABLED(CONFIG_THINGSBOARD_TELEMETRY_BACKLOG), NULL, NULL, &sent);
+		if (err == 0) {
+			LOG_DBG("Sent %zu queued entries", n);
+			queue_pop(n);
+			continue;
+		}
+
+		if (err == -EMSGSIZE || (err == -EINVAL && n == 1)) {
+			/* The first entry can not be sent at all, get rid of it */
+			LOG_ERR("Dropping queued entry, failed to encode: %d", err);
+			queue_pop(1);
+			continue;
+		}
+
+		if (err != -EIO && n > 1) {
+			/* Try again with less entries, fewer requests are needed then */
+			chunk = n / 2;
+			continue;
+		}
+
+		/* Entries sent before the failure must not be sent again */
+		queue_pop(sent);
+
+		LOG_DBG("Failed to send queued telemetry (%d), retrying later", err);
+		(void)k_work_reschedule(
+			k_work_delayable_from_work(work),
+			K_MSEC(CONFIG_THINGSBOARD_TELEMETRY_QUEUE_RETRY_INTERVAL_MS));
+		break;
+	}
+
+	(void)k_mutex_unlock(&queue_lock);
+}
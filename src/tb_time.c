@@ -7,10 +7,24 @@
 
 LOG_MODULE_REGISTER(thingsboard_time, CONFIG_THINGSBOARD_LOG_LEVEL);
 
+#define MAX_RTT_MS            CONFIG_THINGSBOARD_TIME_MAX_RTT_MS
+#define RETRY_INTERVAL        K_SECONDS(CONFIG_THINGSBOARD_TIME_RETRY_INTERVAL_SECONDS)
+#define DRIFT_MIN_INTERVAL_MS (CONFIG_THINGSBOARD_TIME_DRIFT_MIN_INTERVAL_SECONDS * MSEC_PER_SEC)
+#define MAX_DRIFT_ERROR_PPB   (CONFIG_THINGSBOARD_TIME_DRIFT_MAX_ERROR_PPM * 1000LL)
+/* Larger drifts are not caused by the oscillator, but e.g. by adjusting the server clock */
+#define MAX_DRIFT_PPB         1000000
+#define PPB                   1000000000LL
+
 static struct {
-	int64_t tb_time;      // actual Unix timestamp in ms
-	int64_t own_time;     // uptime when receiving timestamp in ms
-	int64_t last_request; // uptime when time was last requested in ms
+	int64_t tb_time;        // actual Unix timestamp in ms
+	int64_t own_time;       // uptime when receiving timestamp in ms
+	bool synced;            // tb_time and own_time are valid
+	int64_t drift_tb_time;  // tb_time at the start of the drift interval
+	int64_t drift_own_time; // own_time at the start of the drift interval
+	int64_t drift_rtt;      // round trip time of the timestamp starting the interval in ms
+	bool drift_started;     // drift_tb_time and drift_own_time are valid
+	int32_t drift_ppb;      // local clock running slow in parts per billion
+	bool drift_known;       // drift_ppb has been measured at least once
 } tb_time;
 
 static void client_request_time(struct k_work *work);
@@ -47,7 +61,63 @@ static int timestamp_from_buf(int64_t *value, const void *buf, size_t sz)
 	return 0;
 }
 
-static void client_handle_time_response(const uint8_t *payload, size_t len)
+/* Estimate the drift of the local clock against the server over long intervals */
+static void drift_update(int64_t ts, int64_t now, int64_t rtt)
+{
+	int64_t own_elapsed = now - tb_time.drift_own_time;
+	int64_t tb_elapsed = ts - tb_time.drift_tb_time;
+
+	if (own_elapsed < DRIFT_MIN_INTERVAL_MS) {
+		return;
+	}
+
+	/* Both timestamps might be off by up to half of their round trip time */
+	int64_t error = (tb_time.drift_rtt + rtt) / 2 * PPB / own_elapsed;
+	if (error > MAX_DRIFT_ERROR_PPB) {
+		/* Keep the start, the error shrinks as the interval grows */
+		LOG_DBG("Drift estimate could be off by %lld ppb, waiting for a longer interval",
+			error);
+		return;
+	}
+
+	tb_time.drift_tb_time = ts;
+	tb_time.drift_own_time = now;
+	tb_time.drift_rtt = rtt;
+
+	int64_t drift = (tb_elapsed - own_elapsed) * PPB / own_elapsed;
+	if (drift > MAX_DRIFT_PPB || drift < -MAX_DRIFT_PPB) {
+		LOG_WRN("Ignored implausible clock drift of %lld ppb", drift);
+		return;
+	}
+
+	/* Smooth out the error caused by asymmetric latencies */
+	if (tb_time.drift_known) {
+		drift = tb_time.drift_ppb + (drift - tb_time.drift_ppb) / 2;
+	}
+	tb_time.drift_ppb = drift;
+	tb_time.drift_known = true;
+}
+
+static void time_sample(int64_t ts, int64_t now, int64_t rtt)
+{
+	if (rtt > MAX_RTT_MS) {
+		/* Not suitable to start a drift interval */
+		tb_time.drift_started = false;
+	} else if (!tb_time.drift_started) {
+		tb_time.drift_tb_time = ts;
+		tb_time.drift_own_time = now;
+		tb_time.drift_rtt = rtt;
+		tb_time.drift_started = true;
+	} else {
+		drift_update(ts, now, rtt);
+	}
+
+	tb_time.tb_time = ts;
+	tb_time.own_time = now;
+	tb_time.synced = true;
+}
+
+static void client_handle_time_response(const uint8_t *payload, size_t len, int64_t sent_at)
 {
 	int64_t ts = 0;
 	int err;
@@ -70,12 +140,31 @@ static void client_handle_time_response(const uint8_t *payload, size_t len)
 		return;
 	}
 
-	tb_time.tb_time = ts;
-	tb_time.own_time = k_uptime_get();
-	LOG_DBG("Timestamp updated: %lld", ts);
+	/* Measured per request, responses to earlier requests might still arrive after a retry */
+	int64_t now = k_uptime_get();
+	int64_t rtt = now - sent_at;
+
+	if (rtt > MAX_RTT_MS && tb_time.synced) {
+		LOG_WRN("Discarded timestamp, round trip took %lld ms", rtt);
+		k_work_reschedule(&work_time, RETRY_INTERVAL);
+		return;
+	}
+
+	/* The server took the timestamp about half way through the round trip */
+	ts += rtt / 2;
+
+	time_sample(ts, now, rtt);
+	LOG_DBG("Timestamp updated: %lld, round trip %lld ms, drift %d ppb", ts, rtt,
+		tb_time.drift_ppb);
 
 	thingsboard_event(THINGSBOARD_EVENT_TIME_UPDATE);
 
+	if (rtt > MAX_RTT_MS) {
+		/* Better than no time at all, but try to get a more accurate one soon */
+		k_work_reschedule(&work_time, RETRY_INTERVAL);
+		return;
+	}
+
 	/* schedule a refresh request for later. */
 	k_work_reschedule(&work_time, K_SECONDS(CONFIG_THINGSBOARD_TIME_REFRESH_INTERVAL_SECONDS));
 
@@ -101,8 +190,6 @@ static void client_request_time(struct k_work *work)
 		LOG_ERR("Failed to request time");
 	}
 
-	tb_time.last_request = k_uptime_get();
-
 out:
 	// Fallback to ask for time, if we don't receive a response.
 	k_work_reschedule(
@@ -117,7 +204,9 @@ time_t thingsboard_time(void)
 
 int64_t thingsboard_time_msec(void)
 {
-	return (k_uptime_get() - tb_time.own_time) + tb_time.tb_time;
+	int64_t elapsed = k_uptime_get() - tb_time.own_time;
+
+	return tb_time.tb_time + elapsed + elapsed * tb_time.drift_ppb / PPB;
 }
 
 void thingsboard_start_time_sync(void)
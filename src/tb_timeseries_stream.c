@@ -0,0 +1,204 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+
+#include <thingsboard.h>
+
+#include "tb_internal.h"
+
+LOG_MODULE_REGISTER(tb_timeseries_stream, CONFIG_THINGSBOARD_LOG_LEVEL);
+
+#define STREAM_WINDOW CONFIG_THINGSBOARD_TIMESERIES_STREAM_WINDOW
+/* Delay before trying again, when no request could be allocated */
+#define STREAM_RETRY_DELAY K_MSEC(100)
+
+/* Message in flight */
+struct stream_slot {
+	/* Number of entries carried by the message */
+	size_t count;
+	/* 0 while in flight, 1 once acknowledged, negative on error */
+	atomic_t result;
+};
+
+static struct {
+	/* Source of the running stream, claimed atomically to start one */
+	atomic_ptr_t source;
+	thingsboard_timeseries entries[CONFIG_THINGSBOARD_MAX_TELEMETRY_PER_MESSAGE];
+	/* All entries have been taken from the source */
+	bool end;
+	/* Messages in flight, oldest at `head`. Their entries are only consumed from the
+	 * source once acknowledged, in order.
+	 */
+	struct stream_slot window[STREAM_WINDOW];
+	size_t head;
+	size_t in_flight;
+	/* Entries sent, but not consumed yet */
+	size_t pending;
+	/* First error, stops the stream */
+	atomic_t err;
+} stream;
+
+static void stream_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(stream_work, stream_work_fn);
+
+static void stream_delivery_cb(const struct thingsboard_delivery_status *status, void *user_data)
+{
+	struct stream_slot *slot = user_data;
+
+	if (status->err < 0) {
+		atomic_set(&slot->result, status->err);
+	} else if (status->code_class != 2) {
+		LOG_ERR("Timeseries stream rejected with class %u", status->code_class);
+		atomic_set(&slot->result, -EBADMSG);
+	} else {
+		atomic_set(&slot->result, 1);
+	}
+
+	(void)k_work_reschedule(&stream_work, K_NO_WAIT);
+}
+
+/* Consume the entries of acknowledged messages, in the order they have been sent */
+static void stream_consume(const struct thingsboard_timeseries_source *source)
+{
+	while (stream.in_flight > 0) {
+		struct stream_slot *slot = &stream.window[stream.head];
+		int result = atomic_get(&slot->result);
+
+		if (result == 0) {
+			return;
+		}
+
+		if (result < 0) {
+			(void)atomic_cas(&stream.err, 0, result);
+		} else if (atomic_get(&stream.err) == 0) {
+			/* Entries after a failed message must stay in the source */
+			source->consume(slot->count, source->user_data);
+			stream.pending -= slot->count;
+		}
+
+		stream.head = (stream.head + 1) % STREAM_WINDOW;
+		stream.in_flight--;
+	}
+}
+
+/* Encode and send the next message. Returns 0 if a request has been sent. */
+static int stream_send_next(const struct thingsboard_timeseries_source *source)
+{
+	int ret = source->peek(stream.pending, stream.entries, ARRAY_SIZE(stream.entries),
+			       source->user_data);
+	if (ret <= 0) {
+		return ret == 0 ? -ENODATA : ret;
+	}
+
+	struct thingsboard_request *request =
+		thingsboard_request_alloc(CONFIG_COAP_CLIENT_MESSAGE_SIZE);
+	if (request == NULL) {
+		return -ENOMEM;
+	}
+
+	size_t count = ret;
+	size_t len = request->payload_size;
+	int err = thingsboard_timeseries_encode(stream.entries, &count, request->payload, &len);
+	if (err < 0 || count == 0) {
+		thingsboard_request_free(request);
+		return err < 0 ? -EINVAL : -EMSGSIZE;
+	}
+
+	struct stream_slot *slot = &stream.window[(stream.head + stream.in_flight) % STREAM_WINDOW];
+
+	slot->count = count;
+	atomic_set(&slot->result, 0);
+
+	thingsboard_request_shrink(request, len);
+	request->delivery_cb = stream_delivery_cb;
+	request->delivery_user_data = slot;
+	request->ts_count = count;
+
+	/* The request is freed without calling `stream_delivery_cb` on error */
+	err = thingsboard_send_telemetry_request(request, len);
+	if (err < 0) {
+		return -EIO;
+	}
+
+	stream.in_flight++;
+	stream.pending += count;
+
+	LOG_DBG("Sent %zu stream entries", count);
+
+	return 0;
+}
+
+static void stream_work_fn(struct k_work *work)
+{
+	const struct thingsboard_timeseries_source *source = atomic_ptr_get(&stream.source);
+
+	if (source == NULL) {
+		return;
+	}
+
+	stream_consume(source);
+
+	while (!stream.end && atomic_get(&stream.err) == 0 && stream.in_flight < STREAM_WINDOW) {
+		if (!thingsboard_is_active()) {
+			(void)atomic_cas(&stream.err, 0, -EAGAIN);
+			break;
+		}
+
+		int err = stream_send_next(source);
+		if (err == -ENODATA) {
+			stream.end = true;
+		} else if (err == -ENOMEM) {
+			/* Completion of our own requests reschedules the work */
+			if (stream.in_flight == 0) {
+				(void)k_work_reschedule(k_work_delayable_from_work(work),
+							STREAM_RETRY_DELAY);
+			}
+			return;
+		} else if (err < 0) {
+			(void)atomic_cas(&stream.err, 0, err);
+		}
+	}
+
+	if (stream.in_flight > 0) {
+		return;
+	}
+
+	int err = atomic_get(&stream.err);
+
+	/* Release the stream first, so `done` can start the next one */
+	(void)atomic_ptr_clear(&stream.source);
+
+	if (err < 0) {
+		LOG_ERR("Timeseries stream failed: %d", err);
+	}
+
+	if (source->done != NULL) {
+		source->done(err, source->user_data);
+	}
+}
+
+int thingsboard_send_timeseries_stream(const struct thingsboard_timeseries_source *source)
+{
+	__ASSERT_NO_MSG(source);
+	__ASSERT_NO_MSG(source->peek);
+	__ASSERT_NO_MSG(source->consume);
+
+	if (!thingsboard_is_active()) {
+		return -EAGAIN;
+	}
+
+	if (!atomic_ptr_cas(&stream.source, NULL, (atomic_ptr_val_t)source)) {
+		return -EBUSY;
+	}
+
+	/* The work is not scheduled while no stream is running */
+	stream.end = false;
+	stream.head = 0;
+	stream.in_flight = 0;
+	stream.pending = 0;
+	atomic_set(&stream.err, 0);
+
+	(void)k_work_reschedule(&stream_work, K_NO_WAIT);
+
+	return 0;
+}
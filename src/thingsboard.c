@@ -17,7 +17,37 @@ struct thingsboard_client thingsboard_client = {
 };
 
 K_MEM_SLAB_DEFINE_STATIC(request_slab, sizeof(struct thingsboard_request),
-			 CONFIG_COAP_CLIENT_MAX_REQUESTS, 4);
+			 CONFIG_THINGSBOARD_REQUEST_COUNT, 4);
+
+/* Payloads are allocated separately from the request itself, from the smallest
+ * size class fitting the requested payload size. This way, small requests do
+ * not need to reserve a buffer sized for the largest possible CoAP message.
+ */
+#define PAYLOAD_BLOCK_SIZE(sz) ROUND_UP(sz, 4)
+
+K_MEM_SLAB_DEFINE_STATIC(payload_slab_small,
+			 PAYLOAD_BLOCK_SIZE(CONFIG_THINGSBOARD_REQUEST_PAYLOAD_SMALL_SIZE),
+			 CONFIG_THINGSBOARD_REQUEST_PAYLOAD_SMALL_COUNT, 4);
+K_MEM_SLAB_DEFINE_STATIC(payload_slab_medium,
+			 PAYLOAD_BLOCK_SIZE(CONFIG_THINGSBOARD_REQUEST_PAYLOAD_MEDIUM_SIZE),
+			 CONFIG_THINGSBOARD_REQUEST_PAYLOAD_MEDIUM_COUNT, 4);
+K_MEM_SLAB_DEFINE_STATIC(payload_slab_large, PAYLOAD_BLOCK_SIZE(CONFIG_COAP_CLIENT_MESSAGE_SIZE),
+			 CONFIG_THINGSBOARD_REQUEST_PAYLOAD_LARGE_COUNT, 4);
+
+BUILD_ASSERT(CONFIG_THINGSBOARD_REQUEST_PAYLOAD_SMALL_SIZE <=
+		     CONFIG_THINGSBOARD_REQUEST_PAYLOAD_MEDIUM_SIZE,
+	     "Small payload size class must not be larger than medium size class");
+BUILD_ASSERT(CONFIG_THINGSBOARD_REQUEST_PAYLOAD_MEDIUM_SIZE <= CONFIG_COAP_CLIENT_MESSAGE_SIZE,
+	     "Medium payload size class must not be larger than CoAP message size");
+
+static const struct {
+	struct k_mem_slab *slab;
+	size_t size;
+} payload_classes[] = {
+	{&payload_slab_small, CONFIG_THINGSBOARD_REQUEST_PAYLOAD_SMALL_SIZE},
+	{&payload_slab_medium, CONFIG_THINGSBOARD_REQUEST_PAYLOAD_MEDIUM_SIZE},
+	{&payload_slab_large, CONFIG_COAP_CLIENT_MESSAGE_SIZE},
+};
 
 static void start_client(void);
 
@@ -67,8 +97,31 @@ int thingsboard_cat_path(const char *in[], char *out, size_t out_len)
 	return 0;
 }
 
-struct thingsboard_request *thingsboard_request_alloc(void)
+static int payload_alloc(size_t size, size_t max_class, char **payload, uint8_t *payload_class)
+{
+	for (size_t i = 0; i < MIN(max_class, ARRAY_SIZE(payload_classes)); i++) {
+		if (payload_classes[i].size < size) {
+			continue;
+		}
+
+		void *block;
+		if (k_mem_slab_alloc(payload_classes[i].slab, &block, K_NO_WAIT) == 0) {
+			*payload = block;
+			*payload_class = i;
+			return 0;
+		}
+	}
+
+	return -ENOMEM;
+}
+
+struct thingsboard_request *thingsboard_request_alloc(size_t payload_size)
 {
+	if (payload_size > CONFIG_COAP_CLIENT_MESSAGE_SIZE) {
+		LOG_ERR("Requested payload size too large: %zu", payload_size);
+		return NULL;
+	}
+
 	void *slab;
 	int err = k_mem_slab_alloc(&request_slab, &slab, K_NO_WAIT);
 	if (err != 0) {
@@ -78,11 +131,51 @@ struct thingsboard_request *thingsboard_request_alloc(void)
 
 	memset(slab, 0, sizeof(struct thingsboard_request));
 
-	return slab;
+	struct thingsboard_request *request = slab;
+
+	if (payload_size == 0) {
+		return request;
+	}
+
+	err = payload_alloc(payload_size, ARRAY_SIZE(payload_classes), &request->payload,
+			    &request->payload_class);
+	if (err < 0) {
+		LOG_ERR("Failed to allocate payload of %zu B", payload_size);
+		k_mem_slab_free(&request_slab, slab);
+		return NULL;
+	}
+	request->payload_size = payload_classes[request->payload_class].size;
+
+	return request;
+}
+
+void thingsboard_request_shrink(struct thingsboard_request *request, size_t len)
+{
+	char *payload;
+	uint8_t payload_class;
+
+	if (request->payload == NULL || request->payload_class == 0) {
+		return;
+	}
+
+	/* Only smaller size classes are of interest, keep the current buffer otherwise */
+	if (payload_alloc(len, request->payload_class, &payload, &payload_class) < 0) {
+		return;
+	}
+
+	memcpy(payload, request->payload, len);
+	k_mem_slab_free(payload_classes[request->payload_class].slab, request->payload);
+
+	request->payload = payload;
+	request->payload_class = payload_class;
+	request->payload_size = payload_classes[payload_class].size;
 }
 
 void thingsboard_request_free(struct thingsboard_request *request)
 {
+	if (request->payload != NULL) {
+		k_mem_slab_free(payload_classes[request->payload_class].slab, request->payload);
+	}
 	k_mem_slab_free(&request_slab, request);
 }
 
@@ -120,6 +213,13 @@ static void thingsboard_handle_state_connecting(void)
 static void thingsboard_handle_state_connected(void)
 {
 	thingsboard_event(THINGSBOARD_EVENT_ACTIVE);
+
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+	thingsboard_telemetry_backlog_send();
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_QUEUE
+	thingsboard_telemetry_queue_drain();
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_QUEUE */
 }
 
 static void thingsboard_handle_state_suspended(void)
@@ -307,11 +407,116 @@ static void coap_response_code_to_str(uint8_t code, char str[5])
 	sprintf(str, "%" PRIu8 ".%02" PRIu8, class, detail);
 }
 
+void thingsboard_attributes_apply(thingsboard_attributes *attr, const uint32_t *deleted,
+				  const struct thingsboard_attributes_meta *meta)
+{
+	uint32_t changed[THINGSBOARD_ATTRIBUTES_MASK_WORDS] = {0};
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	void *buffer = &thingsboard_client.shared_attributes_buffer;
+	size_t buffer_len = sizeof(thingsboard_client.shared_attributes_buffer);
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	void *buffer = NULL;
+	size_t buffer_len = 0;
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+	ssize_t removed = thingsboard_attributes_delete(&thingsboard_client.shared_attributes,
+							buffer, buffer_len, deleted, changed);
+	if (removed < 0) {
+		LOG_ERR("Failed to delete shared attributes: %d", (int)removed);
+		return;
+	}
+
+	ssize_t ret = thingsboard_attributes_update(attr, &thingsboard_client.shared_attributes,
+						    buffer, buffer_len, changed);
+	if (ret < 0) {
+		LOG_ERR("Failed to update shared attributes: %d", (int)ret);
+		return;
+	}
+
+	LOG_DBG("%zi shared attributes changed, %zi deleted", ret, removed);
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF
+	thingsboard_attributes_meta_commit(meta);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_PROTOBUF */
+
+	/* Deleted attributes are reported as changed, with their `has_` flag cleared */
+	ret += removed;
+
+	if (ret > 0) {
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_SNAPSHOT
+		thingsboard_attributes_snapshot_publish();
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_SNAPSHOT */
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_STORE
+		thingsboard_attributes_store_changed();
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_STORE */
+
+		thingsboard_attributes_dispatch(changed);
+	}
+
+#ifdef CONFIG_THINGSBOARD_FOTA
+	thingsboard_fota_on_attributes();
+#endif
+
+	if (thingsboard_client.config != NULL &&
+	    thingsboard_client.config->callbacks.on_attributes_write) {
+		thingsboard_client.config->callbacks.on_attributes_write(attr);
+	}
+}
+
+static void client_attributes_received(thingsboard_attributes *attr, const uint32_t *deleted,
+				       const struct thingsboard_attributes_meta *meta)
+{
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_COALESCE
+	thingsboard_attributes_coalesce(attr, deleted, meta);
+#else  /* CONFIG_THINGSBOARD_ATTRIBUTES_COALESCE */
+	thingsboard_attributes_apply(attr, deleted, meta);
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_COALESCE */
+}
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE
+/* Notification being received block-wise, protected by the Thingsboard lock */
+static struct thingsboard_attributes_stream attributes_stream;
+
+static void client_handle_attribute_block(size_t offset, const uint8_t *payload, size_t len,
+					  bool last_block)
+{
+	if (offset == 0) {
+		thingsboard_attributes_stream_init(&attributes_stream);
+	}
+
+	int err = thingsboard_attributes_stream_feed(&attributes_stream, offset,
+						     (const char *)payload, len);
+	if (err < 0) {
+		if (last_block) {
+			LOG_ERR("Parsing block-wise attributes failed: %d", err);
+		}
+		return;
+	}
+
+	if (!last_block) {
+		return;
+	}
+
+	err = thingsboard_attributes_stream_finish(&attributes_stream);
+	if (err < 0) {
+		LOG_ERR("Parsing block-wise attributes failed: %d", err);
+		return;
+	}
+
+	client_attributes_received(&attributes_stream.attributes, attributes_stream.deleted,
+				   &attributes_stream.meta);
+}
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE */
+
 static void client_handle_attribute_notification(int16_t result_code, size_t offset,
 						 const uint8_t *payload, size_t len,
 						 bool last_block, void *user_data)
 {
 	thingsboard_attributes attr = {0};
+	uint32_t deleted[THINGSBOARD_ATTRIBUTES_MASK_WORDS] = {0};
+	struct thingsboard_attributes_meta meta = {0};
 	struct thingsboard_request *request = user_data;
 	int err;
 
@@ -327,43 +532,32 @@ static void client_handle_attribute_notification(int16_t result_code, size_t off
 		goto out;
 	}
 
+	if (offset > 0 || !last_block) {
+		LOG_HEXDUMP_DBG(payload, len, "Received attributes block");
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE
+		client_handle_attribute_block(offset, payload, len, last_block);
+#else  /* CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE */
+		if (last_block) {
+			LOG_ERR("Dropped block-wise attributes, enable "
+				"CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE");
+		}
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE */
+		goto out;
+	}
+
 	if (!len) {
 		LOG_WRN("Received empty attributes");
 		goto out;
 	}
 	LOG_HEXDUMP_DBG(payload, len, "Received attributes");
 
-	err = thingsboard_attributes_decode(payload, len, &attr);
+	err = thingsboard_attributes_decode(payload, len, &attr, deleted, &meta);
 	if (err < 0) {
 		LOG_ERR("Parsing attributes failed");
 		goto out;
 	}
 
-#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
-	ssize_t ret =
-		thingsboard_attributes_update(&attr, &thingsboard_client.shared_attributes,
-					      &thingsboard_client.shared_attributes_buffer,
-					      sizeof(thingsboard_client.shared_attributes_buffer));
-#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
-	ssize_t ret = thingsboard_attributes_update(&attr, &thingsboard_client.shared_attributes,
-						    NULL, 0);
-#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
-	if (ret < 0) {
-		LOG_ERR("Failed to update shared attributes: %d", (int)ret);
-		thingsboard_unlock();
-		return;
-	}
-
-	LOG_DBG("%zi shared attributes changed", ret);
-
-#ifdef CONFIG_THINGSBOARD_FOTA
-	thingsboard_fota_on_attributes();
-#endif
-
-	if (thingsboard_client.config != NULL &&
-	    thingsboard_client.config->callbacks.on_attributes_write) {
-		thingsboard_client.config->callbacks.on_attributes_write(&attr);
-	}
+	client_attributes_received(&attr, deleted, &meta);
 
 out:
 	if (last_block && result_code < 0) {
@@ -381,27 +575,18 @@ int thingsboard_client_subscribe_attributes(void)
 
 	__ASSERT_NO_MSG(thingsboard_client.attributes_observation == NULL);
 
-	thingsboard_client.attributes_observation = thingsboard_request_alloc();
+	thingsboard_client.attributes_observation = thingsboard_request_alloc(0);
 	if (thingsboard_client.attributes_observation == NULL) {
 		return -ENOMEM;
 	}
 
-	err = thingsboard_cat_path(THINGSBOARD_PATH_ATTRIBUTES,
-				   thingsboard_client.attributes_observation->path,
-				   sizeof(thingsboard_client.attributes_observation->path));
-	if (err < 0) {
-		thingsboard_request_free(thingsboard_client.attributes_observation);
-		thingsboard_client.attributes_observation = NULL;
-		return -EFAULT;
-	}
-
 	thingsboard_client.attributes_observation->options[0].code = COAP_OPTION_OBSERVE;
 	thingsboard_client.attributes_observation->options[0].len = 0;
 
 	struct coap_client_request coap_request = {
 		.confirmable = true,
 		.method = COAP_METHOD_GET,
-		.path = thingsboard_client.attributes_observation->path,
+		.path = thingsboard_client.paths.attributes,
 		.options = thingsboard_client.attributes_observation->options,
 		.num_options = 1,
 		.cb = client_handle_attribute_notification,
@@ -436,16 +621,110 @@ int thingsboard_client_unsubscribe_attributes(void)
 	return 0;
 }
 
-int thingsboard_send_telemetry_request(struct thingsboard_request *request, size_t sz);
+static int thingsboard_send_telemetry_untimed(const thingsboard_telemetry *telemetry,
+					      bool confirmable, thingsboard_delivery_callback_t cb,
+					      void *user_data)
+{
+	if (!thingsboard_is_active()) {
+		return -EAGAIN;
+	}
+
+	struct thingsboard_request *request =
+		thingsboard_request_alloc(CONFIG_COAP_CLIENT_MESSAGE_SIZE);
+	if (request == NULL) {
+		return -ENOMEM;
+	}
+
+	size_t buffer_length = request->payload_size;
+	int err = thingsboard_telemetry_encode(telemetry, request->payload, &buffer_length);
+	if (err < 0) {
+		thingsboard_request_free(request);
+		return err;
+	}
+
+	thingsboard_request_shrink(request, buffer_length);
+	request->non_confirmable = !confirmable;
+	request->delivery_cb = cb;
+	request->delivery_user_data = user_data;
+	request->ts_count = 1;
+
+	return thingsboard_send_telemetry_request(request, buffer_length);
+}
 
 int thingsboard_send_telemetry(const thingsboard_telemetry *telemetry)
 {
 	__ASSERT_NO_MSG(telemetry);
 
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP
+	thingsboard_timeseries timeseries = {
+		.ts = thingsboard_time_msec(),
+		.has_values = true,
+		.values = *telemetry,
+	};
+
+	return thingsboard_send_timeseries(&timeseries, 1);
+#else  /* CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP */
+	return thingsboard_send_telemetry_untimed(telemetry, true, NULL, NULL);
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP */
+}
+
+int thingsboard_send_telemetry_non_confirmable(const thingsboard_telemetry *telemetry)
+{
+	__ASSERT_NO_MSG(telemetry);
+
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP
+	thingsboard_timeseries timeseries = {
+		.ts = thingsboard_time_msec(),
+		.has_values = true,
+		.values = *telemetry,
+	};
+
+	return thingsboard_send_timeseries_non_confirmable(&timeseries, 1);
+#else  /* CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP */
+	return thingsboard_send_telemetry_untimed(telemetry, false, NULL, NULL);
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP */
+}
+
+int thingsboard_send_timeseries(const thingsboard_timeseries *ts, size_t ts_count)
+{
+#if defined(CONFIG_THINGSBOARD_TELEMETRY_QUEUE)
+	/* Keep the order of telemetry data, as long as there is still queued data. With the
+	 * backlog, only data which is not acknowledged is persisted.
+	 */
+	if (thingsboard_is_active() && thingsboard_telemetry_queue_is_empty()) {
+		int err = thingsboard_send_timeseries_direct(
+			ts, ts_count, true, IS_ENABLED(CONFIG_THINGSBOARD_TELEMETRY_BACKLOG), NULL,
+			NULL, NULL);
+		if (err != -ENOMEM) {
+			return err;
+		}
+		LOG_DBG("Out of requests, queueing telemetry");
+	}
+
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+	int err = thingsboard_telemetry_backlog_put(ts, ts_count);
+#else  /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
+	int err = thingsboard_telemetry_queue_put(ts, ts_count);
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
+	if (thingsboard_is_active()) {
+		thingsboard_telemetry_queue_drain();
+	}
+
+	return err;
+#else  /* CONFIG_THINGSBOARD_TELEMETRY_QUEUE */
 	if (!thingsboard_is_active()) {
 		return -EAGAIN;
 	}
 
+	return thingsboard_send_timeseries_direct(ts, ts_count, true, false, NULL, NULL, NULL);
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_QUEUE */
+}
+
+int thingsboard_send_telemetry_cb(const thingsboard_telemetry *telemetry,
+				  thingsboard_delivery_callback_t cb, void *user_data)
+{
+	__ASSERT_NO_MSG(telemetry);
+
 #ifdef CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP
 	thingsboard_timeseries timeseries = {
 		.ts = thingsboard_time_msec(),
@@ -453,30 +732,37 @@ int thingsboard_send_telemetry(const thingsboard_telemetry *telemetry)
 		.values = *telemetry,
 	};
 
-	return thingsboard_send_timeseries(&timeseries, 1);
+	return thingsboard_send_timeseries_cb(&timeseries, 1, cb, user_data);
 #else  /* CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP */
-	struct thingsboard_request *request = thingsboard_request_alloc();
-	if (request == NULL) {
-		return -ENOMEM;
-	}
+	return thingsboard_send_telemetry_untimed(telemetry, true, cb, user_data);
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP */
+}
 
-	size_t buffer_length = sizeof(request->payload);
-	int err = thingsboard_telemetry_encode(telemetry, request->payload, &buffer_length);
-	if (err < 0) {
-		thingsboard_request_free(request);
-		return err;
+int thingsboard_send_timeseries_cb(const thingsboard_timeseries *ts, size_t ts_count,
+				   thingsboard_delivery_callback_t cb, void *user_data)
+{
+	/* The application handles retries, do not queue */
+	if (!thingsboard_is_active()) {
+		return -EAGAIN;
 	}
 
-	return thingsboard_send_telemetry_request(request, buffer_length);
-#endif /* CONFIG_THINGSBOARD_TELEMETRY_ALWAYS_TIMESTAMP */
+	return thingsboard_send_timeseries_direct(ts, ts_count, true, false, cb, user_data, NULL);
 }
 
-int thingsboard_send_timeseries(const thingsboard_timeseries *ts, size_t ts_count)
+int thingsboard_send_timeseries_non_confirmable(const thingsboard_timeseries *ts, size_t ts_count)
 {
+	/* Best effort data is neither queued nor persisted */
 	if (!thingsboard_is_active()) {
 		return -EAGAIN;
 	}
 
+	return thingsboard_send_timeseries_direct(ts, ts_count, false, false, NULL, NULL, NULL);
+}
+
+int thingsboard_send_timeseries_direct(const thingsboard_timeseries *ts, size_t ts_count,
+				       bool confirmable, bool persist, thingsboard_delivery_callback_t cb,
+				       void *user_data, size_t *sent)
+{
 	int err = 0;
 	struct thingsboard_request *requests[CONFIG_COAP_CLIENT_MAX_REQUESTS] = {NULL};
 	size_t payload_len[CONFIG_COAP_CLIENT_MAX_REQUESTS] = {0};
@@ -485,6 +771,7 @@ int thingsboard_send_timeseries(const thingsboard_timeseries *ts, size_t ts_coun
 
 	__ASSERT_NO_MSG(ts);
 	__ASSERT_NO_MSG(ts_count > 0);
+	__ASSERT_NO_MSG(!persist || (confirmable && IS_ENABLED(CONFIG_THINGSBOARD_TELEMETRY_BACKLOG)));
 
 	/* Serialize all telemetry data and prepare all requests to be sent.
 	 *
@@ -492,14 +779,21 @@ int thingsboard_send_timeseries(const thingsboard_timeseries *ts, size_t ts_coun
 	 * and can send all of them at once or none of them.
 	 */
 	while ((ts_count - ts_sent) > 0) {
-		struct thingsboard_request *request = thingsboard_request_alloc();
+		struct thingsboard_request *request =
+			thingsboard_request_alloc(CONFIG_COAP_CLIENT_MESSAGE_SIZE);
 		if (request == NULL) {
 			err = -ENOMEM;
 			goto free_requests;
 		}
 		requests[request_num] = request;
-
-		size_t buffer_length = sizeof(request->payload);
+		request->non_confirmable = !confirmable;
+		request->delivery_cb = cb;
+		request->delivery_user_data = user_data;
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+		request->backlog_persist = persist;
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
+
+		size_t buffer_length = request->payload_size;
 		size_t ts_to_send = ts_count - ts_sent;
 		err = thingsboard_timeseries_encode(&ts[ts_sent], &ts_to_send, request->payload,
 						    &buffer_length);
@@ -507,16 +801,31 @@ int thingsboard_send_timeseries(const thingsboard_timeseries *ts, size_t ts_coun
 			err = -EINVAL;
 			goto free_requests;
 		}
-		__ASSERT_NO_MSG(ts_to_send != 0);
+		if (ts_to_send == 0) {
+			/* Not even a single entry fits into one message */
+			err = -EMSGSIZE;
+			goto free_requests;
+		}
+
+		/* Free the large buffer as early as possible, it is needed for the next chunk */
+		thingsboard_request_shrink(request, buffer_length);
 
 		payload_len[request_num] = buffer_length;
+		request->ts_count = ts_to_send;
 		request_num++;
 
 		ts_sent += ts_to_send;
 	}
 
+	if (sent != NULL) {
+		*sent = 0;
+	}
+
 	/* Send all prepared requests */
 	for (size_t i = 0; i < request_num; i++) {
+		/* The request might be freed by its completion right after sending */
+		size_t count = requests[i]->ts_count;
+
 		err = thingsboard_send_telemetry_request(requests[i], payload_len[i]);
 		if (err < 0) {
 			for (i++; i < request_num; i++) {
@@ -524,18 +833,43 @@ int thingsboard_send_timeseries(const thingsboard_timeseries *ts, size_t ts_coun
 			}
 			return -EIO;
 		}
+
+		if (sent != NULL) {
+			*sent += count;
+		}
 	}
 
 	return 0;
 
 free_requests:
-	for (size_t i = 0; i <= request_num; i++) {
-		thingsboard_request_free(requests[i]);
+	for (size_t i = 0; i < ARRAY_SIZE(requests); i++) {
+		if (requests[i] != NULL) {
+			thingsboard_request_free(requests[i]);
+		}
 	}
 
 	return err;
 }
 
+static void thingsboard_report_delivery(struct thingsboard_request *request, int16_t result_code)
+{
+	struct thingsboard_delivery_status status = {
+		.rtt_ms = k_uptime_get() - request->sent_at,
+		.ts_count = request->ts_count,
+	};
+
+	if (result_code < 0) {
+		status.err = result_code;
+	} else {
+		uint8_t detail;
+
+		status.code = result_code;
+		coap_decode_response_code(status.code, &status.code_class, &detail);
+	}
+
+	request->delivery_cb(&status, request->delivery_user_data);
+}
+
 static void thingsboard_handle_response(int16_t result_code, size_t offset, const uint8_t *payload,
 					size_t len, bool last_block, void *user_data)
 {
@@ -543,17 +877,24 @@ static void thingsboard_handle_response(int16_t result_code, size_t offset, cons
 
 	if (result_code < 0) {
 		LOG_ERR("Failed to send request: %" PRId16, result_code);
-		goto out;
-	}
+	} else {
+		char code_str[5];
 
-	uint8_t code = result_code;
-	char code_str[5];
-
-	coap_response_code_to_str(code, code_str);
-	LOG_DBG("Request completed with code %s", code_str);
+		coap_response_code_to_str(result_code, code_str);
+		LOG_DBG("Request completed with code %s", code_str);
+	}
 
-out:
 	if (last_block) {
+		if (request->delivery_cb != NULL) {
+			thingsboard_report_delivery(request, result_code);
+		}
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+		if (request->backlog_record != 0 || request->backlog_persist) {
+			/* The backlog deletes, retries or stores the data and frees the request */
+			thingsboard_telemetry_backlog_done(request, result_code);
+			return;
+		}
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
 		thingsboard_request_free(request);
 	}
 }
@@ -567,11 +908,11 @@ int thingsboard_send_telemetry_buf(const void *payload, size_t sz)
 		return -EAGAIN;
 	}
 
-	if (sz > sizeof(((struct thingsboard_request){}).payload)) {
+	if (sz > CONFIG_COAP_CLIENT_MESSAGE_SIZE) {
 		return -EINVAL;
 	}
 
-	struct thingsboard_request *request = thingsboard_request_alloc();
+	struct thingsboard_request *request = thingsboard_request_alloc(sz);
 	if (request == NULL) {
 		return -ENOMEM;
 	}
@@ -581,25 +922,41 @@ int thingsboard_send_telemetry_buf(const void *payload, size_t sz)
 	return thingsboard_send_telemetry_request(request, sz);
 }
 
-int thingsboard_send_telemetry_request(struct thingsboard_request *request, size_t sz)
+static void thingsboard_handle_non_confirmable_response(int16_t result_code, size_t offset,
+							const uint8_t *payload, size_t len,
+							bool last_block, void *user_data)
 {
-	int err;
+	struct thingsboard_request *request = user_data;
 
-	err = thingsboard_cat_path(THINGSBOARD_PATH_TELEMETRY, request->path,
-				   sizeof(request->path));
-	if (err < 0) {
+	if (result_code < 0) {
+		LOG_DBG("Non-confirmable telemetry not answered: %" PRId16, result_code);
+	}
+
+	/* The CoAP client reads the payload until the last block has been sent */
+	if (last_block) {
 		thingsboard_request_free(request);
-		return -EFAULT;
 	}
+}
+
+int thingsboard_send_telemetry_request(struct thingsboard_request *request, size_t sz)
+{
+	int err;
+	bool confirmable = !request->non_confirmable;
+
+	request->sent_at = k_uptime_get();
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+	request->payload_len = sz;
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
 
 	struct coap_client_request coap_request = {
 		.payload = request->payload,
 		.len = sz,
-		.confirmable = true,
+		.confirmable = confirmable,
 		.method = COAP_METHOD_POST,
 		.fmt = THINGSBOARD_DEFAULT_CONTENT_FORMAT,
-		.path = request->path,
-		.cb = thingsboard_handle_response,
+		.path = thingsboard_client.paths.telemetry,
+		.cb = confirmable ? thingsboard_handle_response
+				  : thingsboard_handle_non_confirmable_response,
 		.user_data = request,
 	};
 
@@ -638,7 +995,7 @@ static void thingsboard_handle_rpc_response(int16_t result_code, size_t offset,
 	}
 
 	if (request->rpc_cb) {
-		request->rpc_cb(payload, len);
+		request->rpc_cb(payload, len, request->sent_at);
 	}
 
 out:
@@ -648,24 +1005,19 @@ out:
 }
 
 int thingsboard_send_rpc_request(thingsboard_rpc_request *r,
-				 void (*rpc_cb)(const uint8_t *payload, size_t len))
+				 void (*rpc_cb)(const uint8_t *payload, size_t len, int64_t sent_at))
 {
 	int err;
 
 	__ASSERT_NO_MSG(r);
 
-	struct thingsboard_request *request = thingsboard_request_alloc();
+	struct thingsboard_request *request =
+		thingsboard_request_alloc(CONFIG_COAP_CLIENT_MESSAGE_SIZE);
 	if (request == NULL) {
 		return -ENOMEM;
 	}
 
-	err = thingsboard_cat_path(THINGSBOARD_PATH_RPC, request->path, sizeof(request->path));
-	if (err < 0) {
-		thingsboard_request_free(request);
-		return -EFAULT;
-	}
-
-	size_t request_len = ARRAY_SIZE(request->payload);
+	size_t request_len = request->payload_size;
 	err = thingsboard_rpc_request_encode(r, request->payload, &request_len);
 	if (err < 0) {
 		LOG_ERR("Failed to encode RPC request");
@@ -673,6 +1025,8 @@ int thingsboard_send_rpc_request(thingsboard_rpc_request *r,
 		return -EINVAL;
 	}
 
+	thingsboard_request_shrink(request, request_len);
+
 	request->rpc_cb = rpc_cb;
 	struct coap_client_request coap_request = {
 		.payload = request->payload,
@@ -680,11 +1034,12 @@ int thingsboard_send_rpc_request(thingsboard_rpc_request *r,
 		.confirmable = true,
 		.method = COAP_METHOD_POST,
 		.fmt = THINGSBOARD_DEFAULT_CONTENT_FORMAT,
-		.path = request->path,
+		.path = thingsboard_client.paths.rpc,
 		.cb = thingsboard_handle_rpc_response,
 		.user_data = request,
 	};
 
+	request->sent_at = k_uptime_get();
 	err = coap_client_req(&thingsboard_client.coap_client, thingsboard_client.server_socket,
 			      (struct sockaddr *)thingsboard_client.server_address, &coap_request,
 			      NULL);
@@ -716,6 +1071,41 @@ static void prov_callback(const char *token)
 }
 #endif /* CONFIG_THINGSBOARD_USE_PROVISIONING */
 
+/**
+ * Build all CoAP paths used by the client. Needs to be called, as soon as the
+ * access token is known.
+ */
+static int thingsboard_build_paths(void)
+{
+	int err;
+
+	err = thingsboard_cat_path(THINGSBOARD_PATH_ATTRIBUTES, thingsboard_client.paths.attributes,
+				   sizeof(thingsboard_client.paths.attributes));
+	if (err < 0) {
+		return err;
+	}
+
+	err = thingsboard_cat_path(THINGSBOARD_PATH_TELEMETRY, thingsboard_client.paths.telemetry,
+				   sizeof(thingsboard_client.paths.telemetry));
+	if (err < 0) {
+		return err;
+	}
+
+	err = thingsboard_cat_path(THINGSBOARD_PATH_RPC, thingsboard_client.paths.rpc,
+				   sizeof(thingsboard_client.paths.rpc));
+	if (err < 0) {
+		return err;
+	}
+
+	err = thingsboard_cat_path(THINGSBOARD_PATH_FIRMWARE, thingsboard_client.paths.firmware,
+				   sizeof(thingsboard_client.paths.firmware));
+	if (err < 0) {
+		return err;
+	}
+
+	return 0;
+}
+
 static void start_client(void)
 {
 #ifndef CONFIG_THINGSBOARD_DTLS
@@ -738,6 +1128,16 @@ static void start_client(void)
 	}
 #endif /* CONFIG_THINGSBOARD_DTLS */
 
+	int err = thingsboard_build_paths();
+	if (err < 0) {
+		LOG_ERR("Failed to build CoAP paths, consider increasing "
+			"CONFIG_THINGSBOARD_REQUEST_MAX_PATH_LENGTH: %d",
+			err);
+		thingsboard_socket_close(thingsboard_client.server_socket);
+		thingsboard_set_state(THINGSBOARD_STATE_DISCONNECTED);
+		return;
+	}
+
 #ifdef CONFIG_THINGSBOARD_FOTA
 	thingsboard_fota_init(&thingsboard_client.config->current_firmware);
 
@@ -746,7 +1146,16 @@ static void start_client(void)
 	}
 #endif
 
-	int err = thingsboard_client_subscribe_attributes();
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_FETCH
+	if (thingsboard_client.config->fetch_attributes != NULL) {
+		/* The application observes attributes itself, if needed */
+		err = thingsboard_attributes_fetch_on_connect();
+	} else {
+		err = thingsboard_client_subscribe_attributes();
+	}
+#else  /* CONFIG_THINGSBOARD_ATTRIBUTES_FETCH */
+	err = thingsboard_client_subscribe_attributes();
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_FETCH */
 	if (err < 0) {
 		LOG_ERR("Failed to observe attributes: %d", err);
 		thingsboard_socket_close(thingsboard_client.server_socket);
@@ -829,6 +1238,20 @@ int thingsboard_init(const struct thingsboard_configuration *configuration)
 
 	thingsboard_client.state = THINGSBOARD_STATE_DISCONNECTED;
 
+#ifdef CONFIG_THINGSBOARD_TELEMETRY_BACKLOG
+	ret = thingsboard_telemetry_backlog_init();
+	if (ret < 0) {
+		LOG_WRN("Failed to load telemetry backlog: %d", ret);
+	}
+#endif /* CONFIG_THINGSBOARD_TELEMETRY_BACKLOG */
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_STORE
+	ret = thingsboard_attributes_store_init();
+	if (ret < 0) {
+		LOG_WRN("Failed to restore shared attributes: %d", ret);
+	}
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_STORE */
+
 #ifdef CONFIG_THINGSBOARD_CONNECT_ON_INIT
 	ret = thingsboard_connect();
 	if (ret < 0) {
@@ -11,7 +11,7 @@ LOG_MODULE_REGISTER(thingsboard_json, CONFIG_THINGSBOARD_LOG_LEVEL);
 
 ssize_t thingsboard_attributes_update(thingsboard_attributes *changes,
 				      thingsboard_attributes *current, void *buffer,
-				      size_t buffer_len)
+				      size_t buffer_len, uint32_t *mask)
 {
 	if (changes == NULL || current == NULL || buffer == NULL) {
 		return -EINVAL;
@@ -24,7 +24,7 @@ ssize_t thingsboard_attributes_update(thingsboard_attributes *changes,
 	struct thingsboard_attributes_buffer *attributes_buffer = buffer;
 
 	ssize_t ret =
-		thingsboard_attributes_update_with_buffer(changes, current, attributes_buffer);
+		thingsboard_attributes_update_with_buffer(changes, current, attributes_buffer, mask);
 	if (ret < 0) {
 		return -EFAULT;
 	}
@@ -32,25 +32,379 @@ ssize_t thingsboard_attributes_update(thingsboard_attributes *changes,
 	return ret;
 }
 
-#define JSON_OBJ_DESCR_OBJECT_DYN(struct_, field_name_, sub_descr_, sub_descr_len_)                \
-	{                                                                                          \
-		.field_name = (#field_name_),                                                      \
-		.align_shift = Z_ALIGN_SHIFT(struct_),                                             \
-		.field_name_len = (sizeof(#field_name_) - 1),                                      \
-		.type = JSON_TOK_OBJECT_START,                                                     \
-		.offset = offsetof(struct_, field_name_),                                          \
-		.object =                                                                          \
-			{                                                                          \
-				.sub_descr = sub_descr_,                                           \
-				.sub_descr_len = sub_descr_len_,                                   \
-			},                                                                         \
+ssize_t thingsboard_attributes_delete(thingsboard_attributes *current, void *buffer,
+				      size_t buffer_len, const uint32_t *fields, uint32_t *mask)
+{
+	if (current == NULL || buffer == NULL || fields == NULL) {
+		return -EINVAL;
+	}
+
+	if (buffer_len < sizeof(struct thingsboard_attributes_buffer)) {
+		return -ENOMEM;
+	}
+
+	return thingsboard_attributes_delete_with_buffer(current, buffer, fields, mask);
+}
+
+#ifdef CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES
+ssize_t thingsboard_client_attributes_update(const thingsboard_client_attributes *changes,
+					     thingsboard_client_attributes *current, void *buffer,
+					     size_t buffer_len, uint32_t *mask)
+{
+	if (changes == NULL || current == NULL || buffer == NULL) {
+		return -EINVAL;
+	}
+
+	if (buffer_len < sizeof(struct thingsboard_client_attributes_buffer)) {
+		return -ENOMEM;
+	}
+
+	ssize_t ret = thingsboard_client_attributes_update_with_buffer(changes, current, buffer, mask);
+	if (ret < 0) {
+		return -EFAULT;
+	}
+
+	return ret;
+}
+
+ssize_t thingsboard_client_attributes_delete(thingsboard_client_attributes *current, void *buffer,
+					     size_t buffer_len, const uint32_t *fields,
+					     uint32_t *mask)
+{
+	if (current == NULL || buffer == NULL || fields == NULL) {
+		return -EINVAL;
 	}
 
-int thingsboard_attributes_decode(const char *buffer, size_t len, thingsboard_attributes *v)
+	if (buffer_len < sizeof(struct thingsboard_client_attributes_buffer)) {
+		return -ENOMEM;
+	}
+
+	return thingsboard_client_attributes_delete_with_buffer(current, buffer, fields, mask);
+}
+#endif /* CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES */
+
+/* Appends JSON output directly to a buffer, keeping track of the position, so
+ * the encoded length is known without scanning the output afterwards.
+ */
+struct json_writer {
+	char *buffer;
+	size_t size;
+	size_t pos;
+};
+
+static int json_writer_append(const char *bytes, size_t len, void *data)
 {
-	return thingsboard_attributes_from_json(buffer, len, v);
+	struct json_writer *w = data;
+
+	if (len > w->size - w->pos) {
+		return -ENOMEM;
+	}
+
+	memcpy(&w->buffer[w->pos], bytes, len);
+	w->pos += len;
+
+	return 0;
 }
 
+static int json_writer_int64(struct json_writer *w, int64_t value)
+{
+	char digits[sizeof("-9223372036854775808")];
+	size_t i = sizeof(digits);
+	uint64_t v = value < 0 ? -(uint64_t)value : (uint64_t)value;
+
+	do {
+		digits[--i] = '0' + (v % 10);
+		v /= 10;
+	} while (v > 0);
+
+	if (value < 0) {
+		digits[--i] = '-';
+	}
+
+	return json_writer_append(&digits[i], sizeof(digits) - i, w);
+}
+
+/* Start writing into `buffer`, keeping space for a zero delimiter */
+static int json_writer_init(struct json_writer *w, char *buffer, size_t len)
+{
+	if (len == 0) {
+		return -ENOMEM;
+	}
+
+	*w = (struct json_writer){
+		.buffer = buffer,
+		.size = len - 1,
+	};
+
+	return 0;
+}
+
+/* Terminate the output and return its length, without the zero delimiter */
+static size_t json_writer_finish(struct json_writer *w)
+{
+	w->buffer[w->pos] = 0;
+
+	return w->pos;
+}
+
+/* Find the object ('{') or array ('[') stored under `key` in the top level object of `json` */
+static int json_find_member(const char *json, size_t len, const char *key, char open,
+			    const char **obj, size_t *obj_len)
+{
+	size_t key_len = strlen(key);
+	const char *start = NULL;
+	bool key_found = false;
+	int depth = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		switch (json[i]) {
+		case '"': {
+			size_t begin = ++i;
+
+			for (; i < len && json[i] != '"'; i++) {
+				if (json[i] == '\\') {
+					i++;
+				}
+			}
+			if (i >= len) {
+				return -EINVAL;
+			}
+
+			/* Only keys can be followed by an object or array */
+			key_found = depth == 1 && i - begin == key_len &&
+				    memcmp(&json[begin], key, key_len) == 0;
+			break;
+		}
+		case '{':
+		case '[':
+			if (depth == 1 && key_found && json[i] == open) {
+				start = &json[i];
+			}
+			depth++;
+			break;
+		case '}':
+		case ']':
+			depth--;
+			if (start != NULL && depth == 1) {
+				*obj = start;
+				*obj_len = &json[i] - start + 1;
+				return 0;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int thingsboard_attributes_decode(const char *buffer, size_t len, thingsboard_attributes *v,
+				  uint32_t *deleted, struct thingsboard_attributes_meta *meta)
+{
+	const char *names;
+	size_t names_len;
+
+	/* Deletions look like `{"deleted":["key1","key2"]}`. Thingsboard never mixes deleted and
+	 * updated attributes in the same notification. The scan leaves the buffer untouched, as
+	 * json_obj_parse() modifies it in place.
+	 */
+	if (json_find_member(buffer, len, "deleted", '[', &names, &names_len) < 0) {
+		return thingsboard_attributes_from_json(buffer, len, v);
+	}
+
+	/* The names are terminated in place, there is no limit on their number */
+	char *name_buffer = (char *)names;
+
+	for (size_t i = 1; i < names_len - 1; i++) {
+		if (name_buffer[i] != '"') {
+			continue;
+		}
+
+		const char *name = &name_buffer[++i];
+
+		/* Escaped names can not match any field, they are just skipped */
+		for (; name_buffer[i] != '"'; i++) {
+			if (name_buffer[i] == '\\') {
+				i++;
+			}
+		}
+		name_buffer[i] = 0;
+
+		int field = thingsboard_attributes_field_from_name(name);
+		if (field < 0) {
+			LOG_DBG("Ignoring deletion of unknown attribute \"%s\"", name);
+			continue;
+		}
+
+		thingsboard_attributes_mask_set(deleted, field);
+	}
+
+	return 0;
+}
+
+int thingsboard_attributes_response_decode(const char *buffer, size_t len,
+					   thingsboard_attributes *v,
+					   struct thingsboard_attributes_meta *meta)
+{
+	uint32_t deleted[THINGSBOARD_ATTRIBUTES_MASK_WORDS] = {0};
+	const char *shared;
+	size_t shared_len;
+
+	*v = (thingsboard_attributes){0};
+
+	/* The response looks like `{"client":{...},"shared":{...}}`, where "shared" is left out,
+	 * when none of the requested shared attributes exists.
+	 */
+	if (json_find_member(buffer, len, "shared", '{', &shared, &shared_len) < 0) {
+		return 0;
+	}
+
+	return thingsboard_attributes_decode(shared, shared_len, v, deleted, meta);
+}
+
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE
+void thingsboard_attributes_stream_init(struct thingsboard_attributes_stream *s)
+{
+	*s = (struct thingsboard_attributes_stream){0};
+}
+
+/* Decode the buffered member as an object of its own and merge it into the stream */
+static int stream_decode_member(struct thingsboard_attributes_stream *s)
+{
+	thingsboard_attributes member = {0};
+
+	if (s->len == 0) {
+		return 0;
+	}
+
+	/* Wrap the member into braces, the first one has been reserved */
+	s->member[0] = '{';
+	s->member[s->len + 1] = '}';
+
+	int err = thingsboard_attributes_decode(s->member, s->len + 2, &member, s->deleted,
+						&s->meta);
+
+	s->len = 0;
+
+	if (err < 0) {
+		return -EBADMSG;
+	}
+
+	ssize_t ret = thingsboard_attributes_update(&member, &s->attributes, &s->buffer,
+						    sizeof(s->buffer), NULL);
+
+	return ret < 0 ? ret : 0;
+}
+
+static int stream_feed_char(struct thingsboard_attributes_stream *s, char c)
+{
+	bool member_end = false;
+
+	if (s->in_string) {
+		if (s->escape) {
+			s->escape = false;
+		} else if (c == '\\') {
+			s->escape = true;
+		} else if (c == '"') {
+			s->in_string = false;
+		}
+	} else {
+		switch (c) {
+		case '"':
+			s->in_string = true;
+			break;
+		case '{':
+		case '[':
+			s->depth++;
+			if (s->depth == 1) {
+				/* Opening brace of the notification */
+				return c == '{' ? 0 : -EBADMSG;
+			}
+			break;
+		case '}':
+		case ']':
+			if (s->depth <= 0) {
+				return -EBADMSG;
+			}
+			s->depth--;
+			member_end = s->depth == 0;
+			break;
+		case ',':
+			member_end = s->depth == 1;
+			break;
+		case ' ':
+		case '\t':
+		case '\r':
+		case '\n':
+			/* Drop whitespace between members */
+			if (s->depth <= 1) {
+				return 0;
+			}
+			break;
+		default:
+			break;
+		}
+
+		if (s->depth == 0 && !member_end) {
+			/* Nothing is allowed outside of the notification */
+			return -EBADMSG;
+		}
+	}
+
+	if (member_end) {
+		return stream_decode_member(s);
+	}
+
+	/* Leave room for the braces around the member */
+	if (s->len + 2 >= sizeof(s->member)) {
+		return -EMSGSIZE;
+	}
+
+	s->member[1 + s->len++] = c;
+
+	return 0;
+}
+
+int thingsboard_attributes_stream_feed(struct thingsboard_attributes_stream *s, size_t offset,
+				       const char *data, size_t len)
+{
+	if (s->err < 0) {
+		return s->err;
+	}
+
+	if (offset != s->received) {
+		s->err = -EILSEQ;
+		return s->err;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		int err = stream_feed_char(s, data[i]);
+		if (err < 0) {
+			s->err = err;
+			return err;
+		}
+	}
+
+	s->received += len;
+
+	return 0;
+}
+
+int thingsboard_attributes_stream_finish(struct thingsboard_attributes_stream *s)
+{
+	if (s->err < 0) {
+		return s->err;
+	}
+
+	if (s->received == 0 || s->depth != 0 || s->in_string || s->len != 0) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE */
+
 int thingsboard_rpc_response_decode(const char *buffer, size_t len, thingsboard_rpc_response *rr)
 {
 	/* The RPC response is in JSON format, but not encapsulated. Each
@@ -68,119 +422,138 @@ int thingsboard_rpc_response_decode(const char *buffer, size_t len, thingsboard_
 
 int thingsboard_rpc_request_encode(const thingsboard_rpc_request *rq, char *buffer, size_t *len)
 {
-	int err = thingsboard_rpc_request_to_buf(rq, buffer, *len);
+	struct json_writer w;
+
+	int err = json_writer_init(&w, buffer, *len);
+	if (err == 0) {
+		err = thingsboard_rpc_request_to_json(rq, json_writer_append, &w);
+	}
 	if (err < 0) {
 		LOG_WRN("Failed to encode `thingsboard_rpc_request`: %d", err);
 		return -EINVAL;
 	}
 
-	*len = strlen(buffer);
+	*len = json_writer_finish(&w);
 
 	return 0;
 }
 
 int thingsboard_telemetry_encode(const thingsboard_telemetry *v, char *buffer, size_t *len)
 {
-	int err = thingsboard_telemetry_to_buf(v, buffer, *len);
+	struct json_writer w;
+
+	int err = json_writer_init(&w, buffer, *len);
+	if (err == 0) {
+		err = thingsboard_telemetry_to_json(v, json_writer_append, &w);
+	}
 	if (err < 0) {
 		LOG_WRN("Failed to encode `thingsboard_telemetry`: %d", err);
 		return -EINVAL;
 	}
 
-	*len = strlen(buffer);
+	*len = json_writer_finish(&w);
+
 	return 0;
 }
 
-ssize_t encode_timestamped_telemetry_to_buf(const thingsboard_timeseries *ts, char *buffer,
-					    size_t len)
+#ifdef CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES
+int thingsboard_client_attributes_encode(const thingsboard_client_attributes *v, char *buffer,
+					 size_t *len)
 {
-	struct json_obj_descr values_descr[THINGSBOARD_TELEMETRY_VALUE_COUNT];
+	struct json_writer w;
 
-	ssize_t ret;
-	ret = thingsboard_telemetry_gen_obj_desc(&ts->values, values_descr,
-						 ARRAY_SIZE(values_descr));
-	if (ret <= 0) {
-		return ret;
+	int err = json_writer_init(&w, buffer, *len);
+	if (err == 0) {
+		err = thingsboard_client_attributes_to_json(v, json_writer_append, &w);
+	}
+	if (err < 0) {
+		LOG_WRN("Failed to encode `thingsboard_client_attributes`: %d", err);
+		return -EINVAL;
 	}
 
-	struct json_obj_descr ts_descr[] = {
-		JSON_OBJ_DESCR_PRIM(struct thingsboard_timeseries, ts, JSON_TOK_INT64),
-		JSON_OBJ_DESCR_OBJECT_DYN(struct thingsboard_timeseries, values, values_descr, ret),
-	};
+	*len = json_writer_finish(&w);
+
+	return 0;
+}
+#endif /* CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES */
 
-	int err = json_obj_encode_buf(ts_descr, ARRAY_SIZE(ts_descr), ts, buffer, len);
+static int encode_timeseries_entry(struct json_writer *w, const thingsboard_timeseries *ts)
+{
+	static const char ts_key[] = "{\"ts\":";
+	static const char values_key[] = ",\"values\":";
+	int err;
+
+	err = json_writer_append(ts_key, sizeof(ts_key) - 1, w);
 	if (err < 0) {
 		return err;
 	}
 
-	/* There is currently no nice way to get the encoded object size without
-	 * calling the JSON encoder two times. It guarantees a zero delimiter,
-	 * though.
-	 */
-	return strlen(buffer);
+	err = json_writer_int64(w, ts->ts);
+	if (err < 0) {
+		return err;
+	}
+
+	err = json_writer_append(values_key, sizeof(values_key) - 1, w);
+	if (err < 0) {
+		return err;
+	}
+
+	err = thingsboard_telemetry_to_json(&ts->values, json_writer_append, w);
+	if (err < 0) {
+		return err;
+	}
+
+	return json_writer_append("}", 1, w);
 }
 
 int thingsboard_timeseries_encode(const thingsboard_timeseries *ts, size_t *ts_count, char *buffer,
 				  size_t *len)
 {
-	/* The JSON encoder has no way to describe an array of object of different type.
-	 * But as in our object, a field might or might not be set, every element might be
-	 * different. Thus, encode each object separately and make the array manually.
+	/* Encode each object separately and make the array manually, so that encoding
+	 * stops at the last entry fitting into the buffer.
 	 */
-	size_t pos = 0;
-	size_t left = *len;
 	size_t ts_encoded = 0;
 
 	/* We have at least the opening and closing brackets and zero delimiter */
-	if (left < 3) {
+	if (*len < 3) {
 		return -ENOMEM;
 	}
 
-	buffer[pos++] = '[';
-	left--;
+	/* Keep space for the closing bracket and the zero delimiter */
+	struct json_writer w = {
+		.buffer = buffer,
+		.size = *len - 2,
+	};
+
+	buffer[w.pos++] = '[';
 
 	for (size_t i = 0; i < *ts_count; i++) {
+		/* Position to return to, if the entry does not fit anymore */
+		size_t mark = w.pos;
+
+		int err = 0;
 		if (ts_encoded > 0) {
-			/* If there is only enough space to encode the closing bracket and the zero
-			 * delimiter, directly stop here */
-			if (left <= 2) {
-				break;
-			}
-			buffer[pos++] = ',';
-			left--;
+			err = json_writer_append(",", 1, &w);
 		}
-		/* There are at least 2 bytes needed at the end of the buffer for the closing
-		 * bracket and the zero delimiter, thefore the available buffer is two bytes less
-		 * than the actual space left at this point */
-		ssize_t ret = encode_timestamped_telemetry_to_buf(&ts[i], &buffer[pos], left - 2);
-		if (ret == -ENOMEM) {
+		if (err == 0) {
+			err = encode_timeseries_entry(&w, &ts[i]);
+		}
+		if (err == -ENOMEM) {
 			/* Entry did not fit into buffer, just stop here */
-			if (ts_encoded > 0) {
-				/* remove trailing comma */
-				left++;
-				pos--;
-			}
+			w.pos = mark;
 			break;
 		}
-		if (ret < 0) {
-			return ret;
+		if (err < 0) {
+			return err;
 		}
 
-		pos += ret;
-		left -= ret;
 		ts_encoded++;
 	}
 
-	if (left < 2) {
-		return -ENOMEM;
-	}
-
-	buffer[pos++] = ']';
-	left--;
-
-	buffer[pos] = 0;
+	buffer[w.pos++] = ']';
+	buffer[w.pos] = 0;
 
-	*len = pos;
+	*len = w.pos;
 	*ts_count = ts_encoded;
 
 	return 0;
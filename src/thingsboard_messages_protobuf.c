@@ -1,3 +1,6 @@
+#include <string.h>
+
+#include <zephyr/init.h>
 #include <zephyr/logging/log.h>
 
 #include <pb_encode.h>
@@ -10,8 +13,18 @@ LOG_MODULE_REGISTER(thingsboard_protobuf, CONFIG_THINGSBOARD_LOG_LEVEL);
 #define UPDATE_ATTR_COND_SINGULAR(obj, _fieldname) true
 #define UPDATE_ATTR_COND_OPTIONAL(obj, _fieldname) (obj).has_##_fieldname
 
+#define UPDATE_ATTR_DIFFERS_STRING(_new, _old, _fieldname)                                         \
+	(strncmp((_new)._fieldname, (_old)._fieldname, sizeof((_old)._fieldname)) != 0)
+#define UPDATE_ATTR_DIFFERS_UINT32(_new, _old, _fieldname) ((_new)._fieldname != (_old)._fieldname)
+#define UPDATE_ATTR_DIFFERS_INT32(_new, _old, _fieldname)  ((_new)._fieldname != (_old)._fieldname)
+#define UPDATE_ATTR_DIFFERS_SINT32(_new, _old, _fieldname) ((_new)._fieldname != (_old)._fieldname)
+#define UPDATE_ATTR_DIFFERS_UINT64(_new, _old, _fieldname) ((_new)._fieldname != (_old)._fieldname)
+#define UPDATE_ATTR_DIFFERS_INT64(_new, _old, _fieldname)  ((_new)._fieldname != (_old)._fieldname)
+#define UPDATE_ATTR_DIFFERS_SINT64(_new, _old, _fieldname) ((_new)._fieldname != (_old)._fieldname)
+#define UPDATE_ATTR_DIFFERS_BOOL(_new, _old, _fieldname)   ((_new)._fieldname != (_old)._fieldname)
+
 #define UPDATE_ATTR_FIELD_STRING(_new, _old, _fieldname)                                           \
-	const size_t field_max_length = sizeof(((thingsboard_attributes){})._fieldname);           \
+	const size_t field_max_length = sizeof((_old)._fieldname);                                 \
 	strncpy((_old)._fieldname, (_new)._fieldname, field_max_length);                           \
 	(_old)._fieldname[field_max_length - 1] = 0;
 
@@ -32,16 +45,78 @@ LOG_MODULE_REGISTER(thingsboard_protobuf, CONFIG_THINGSBOARD_LOG_LEVEL);
 #define UPDATE_ATTR_FIELD_BOOL(_new, _old, _fieldname)                                             \
 	UPDATE_ATTR_FIELD_PRIMITIVE(_new, _old, _fieldname)
 
-#define UPDATE_ATTR_FIELDS(_, __, _optional, _type, _fieldname, ___)                               \
-	if (UPDATE_ATTR_COND_##_optional(*changes, _fieldname)) {                                  \
+/* Masks of fields, with one bit per entry of the field enum of a message */
+#define ATTR_MASK_SET(_mask, _field)  ((_mask)[(_field) / 32] |= BIT((_field) % 32))
+#define ATTR_MASK_TEST(_mask, _field) (((_mask)[(_field) / 32] & BIT((_field) % 32)) != 0)
+
+/* `_field_prefix` is the prefix of the field enum of the message, e.g.
+ * `THINGSBOARD_ATTRIBUTES_FIELD_`
+ */
+#define UPDATE_ATTR_FIELDS(_field_prefix, __, _optional, _type, _fieldname, ___)                   \
+	if (UPDATE_ATTR_COND_##_optional(*changes, _fieldname) &&                                  \
+	    (!(*current).has_##_fieldname ||                                                       \
+	     UPDATE_ATTR_DIFFERS_##_type(*changes, *current, _fieldname))) {                       \
 		UPDATE_ATTR_FIELD_##_type(*changes, *current, _fieldname);                         \
 		(*current).has_##_fieldname = true;                                                \
+		if (mask != NULL) {                                                                \
+			ATTR_MASK_SET(mask, _field_prefix##_fieldname);                            \
+		}                                                                                  \
 		fields_updated++;                                                                  \
 	}
 
 ssize_t thingsboard_attributes_update(thingsboard_attributes *changes,
 				      thingsboard_attributes *current, void *buffer,
-				      size_t buffer_len)
+				      size_t buffer_len, uint32_t *mask)
+{
+	(void)buffer;
+	(void)buffer_len;
+
+	if (changes == NULL || current == NULL) {
+		return -EINVAL;
+	}
+
+	size_t fields_updated = 0;
+
+	thingsboard_attributes_FIELDLIST(UPDATE_ATTR_FIELDS, THINGSBOARD_ATTRIBUTES_FIELD_);
+
+	return fields_updated;
+}
+
+#define DELETE_ATTR_SINGULAR(obj, _fieldname)
+#define DELETE_ATTR_OPTIONAL(obj, _fieldname) (obj).has_##_fieldname = false;
+
+#define DELETE_ATTR_FIELDS(_field_prefix, __, _optional, _type, _fieldname, ___)                   \
+	if (ATTR_MASK_TEST(fields, _field_prefix##_fieldname) &&                                   \
+	    UPDATE_ATTR_COND_##_optional(*current, _fieldname)) {                                  \
+		memset(&current->_fieldname, 0, sizeof(current->_fieldname));                      \
+		DELETE_ATTR_##_optional(*current, _fieldname);                                     \
+		if (mask != NULL) {                                                                \
+			ATTR_MASK_SET(mask, _field_prefix##_fieldname);                            \
+		}                                                                                  \
+		fields_deleted++;                                                                  \
+	}
+
+ssize_t thingsboard_attributes_delete(thingsboard_attributes *current, void *buffer,
+				      size_t buffer_len, const uint32_t *fields, uint32_t *mask)
+{
+	(void)buffer;
+	(void)buffer_len;
+
+	if (current == NULL || fields == NULL) {
+		return -EINVAL;
+	}
+
+	size_t fields_deleted = 0;
+
+	thingsboard_attributes_FIELDLIST(DELETE_ATTR_FIELDS, THINGSBOARD_ATTRIBUTES_FIELD_);
+
+	return fields_deleted;
+}
+
+#ifdef CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES
+ssize_t thingsboard_client_attributes_update(const thingsboard_client_attributes *changes,
+					     thingsboard_client_attributes *current, void *buffer,
+					     size_t buffer_len, uint32_t *mask)
 {
 	(void)buffer;
 	(void)buffer_len;
@@ -52,11 +127,49 @@ ssize_t thingsboard_attributes_update(thingsboard_attributes *changes,
 
 	size_t fields_updated = 0;
 
-	thingsboard_attributes_FIELDLIST(UPDATE_ATTR_FIELDS, NULL);
+	thingsboard_client_attributes_FIELDLIST(UPDATE_ATTR_FIELDS,
+						THINGSBOARD_CLIENT_ATTRIBUTES_FIELD_);
 
 	return fields_updated;
 }
 
+ssize_t thingsboard_client_attributes_delete(thingsboard_client_attributes *current, void *buffer,
+					     size_t buffer_len, const uint32_t *fields,
+					     uint32_t *mask)
+{
+	(void)buffer;
+	(void)buffer_len;
+
+	if (current == NULL || fields == NULL) {
+		return -EINVAL;
+	}
+
+	size_t fields_deleted = 0;
+
+	thingsboard_client_attributes_FIELDLIST(DELETE_ATTR_FIELDS,
+						THINGSBOARD_CLIENT_ATTRIBUTES_FIELD_);
+
+	return fields_deleted;
+}
+
+int thingsboard_client_attributes_encode(const thingsboard_client_attributes *v, char *buffer,
+					 size_t *len)
+{
+	pb_ostream_t stream = pb_ostream_from_buffer(buffer, *len);
+
+	bool success = pb_encode(&stream, thingsboard_client_attributes_fields, v);
+	if (!success) {
+		LOG_WRN("Failed to encode `thingsboard_client_attributes`: %s",
+			PB_GET_ERROR(&stream));
+		return -EFAULT;
+	}
+
+	*len = stream.bytes_written;
+
+	return 0;
+}
+#endif /* CONFIG_THINGSBOARD_CLIENT_ATTRIBUTES */
+
 /* Workaround for thingsboard not using specified format in device profile */
 #define DECODE_ATTR_SINGULAR(obj, _fieldname)
 #define DECODE_ATTR_OPTIONAL(obj, _fieldname) (obj).has_##_fieldname = true;
@@ -66,7 +179,7 @@ ssize_t thingsboard_attributes_update(thingsboard_attributes *changes,
 		return false;                                                                      \
 	}                                                                                          \
 	const size_t field_max_length = sizeof(((thingsboard_attributes){})._fieldname);           \
-	strncpy((obj)._fieldname, tkp.kv.string_v, field_max_length);                              \
+	strncpy((obj)._fieldname, string_v, field_max_length);                                     \
 	(obj)._fieldname[field_max_length - 1] = 0;
 
 #define DECODE_ATTR_FIELD_UINT32(obj, _fieldname)                                                  \
@@ -112,43 +225,280 @@ ssize_t thingsboard_attributes_update(thingsboard_attributes *changes,
 	(obj)._fieldname = tkp.kv.long_v;
 
 #define DECODE_ATTR_FIELDS(obj, _, _optional, _type, _fieldname, ___)                              \
-	if (strncmp(tkp.kv.key, #_fieldname, sizeof(tkp.kv.key)) == 0) {                           \
+	case THINGSBOARD_ATTRIBUTES_FIELD_##_fieldname: {                                          \
 		DECODE_ATTR_FIELD_##_type((obj), _fieldname);                                      \
 		DECODE_ATTR_##_optional((obj), _fieldname);                                        \
+		attr_meta_record(ctx->meta, THINGSBOARD_ATTRIBUTES_FIELD_##_fieldname, &tkp);      \
 		return true;                                                                       \
 	}
 
+/* Timestamp and version of the last update applied per attribute, protected by the Thingsboard
+ * lock
+ */
+static struct thingsboard_attribute_meta attr_meta[THINGSBOARD_ATTRIBUTES_FIELD_COUNT];
+
+static bool attr_is_newer(int idx, const TsKvProto *tkp)
+{
+	const struct thingsboard_attribute_meta *meta = &attr_meta[idx];
+
+	if (tkp->has_version && meta->has_version) {
+		return tkp->version > meta->version;
+	}
+
+	if (tkp->ts != 0 && meta->ts != 0) {
+		return tkp->ts > meta->ts;
+	}
+
+	return true;
+}
+
+/* Remember the metadata of a decoded attribute, it is committed once the attribute is applied */
+static void attr_meta_record(struct thingsboard_attributes_meta *meta, int idx,
+			     const TsKvProto *tkp)
+{
+	meta->meta[idx] = (struct thingsboard_attribute_meta){
+		.ts = tkp->ts,
+		.version = tkp->version,
+		.has_version = tkp->has_version,
+	};
+	thingsboard_attributes_mask_set(meta->mask, idx);
+}
+
+void thingsboard_attributes_meta_merge(struct thingsboard_attributes_meta *dst,
+				       const struct thingsboard_attributes_meta *src)
+{
+	for (size_t i = 0; i < THINGSBOARD_ATTRIBUTES_FIELD_COUNT; i++) {
+		if (thingsboard_attributes_mask_test(src->mask, i)) {
+			dst->meta[i] = src->meta[i];
+			thingsboard_attributes_mask_set(dst->mask, i);
+		}
+	}
+}
+
+void thingsboard_attributes_meta_commit(const struct thingsboard_attributes_meta *meta)
+{
+	for (size_t i = 0; i < THINGSBOARD_ATTRIBUTES_FIELD_COUNT; i++) {
+		if (thingsboard_attributes_mask_test(meta->mask, i)) {
+			attr_meta[i] = meta->meta[i];
+		}
+	}
+}
+
+int thingsboard_get_attribute_meta(enum thingsboard_attributes_field field,
+				   struct thingsboard_attribute_meta *meta)
+{
+	if (field >= THINGSBOARD_ATTRIBUTES_FIELD_COUNT || meta == NULL) {
+		return -EINVAL;
+	}
+
+	thingsboard_lock();
+	*meta = attr_meta[field];
+	thingsboard_unlock();
+
+	return 0;
+}
+
+/* Attribute keys are looked up in a hash table, which is built once from the field list and
+ * kept at most half full. Each slot holds the index of the field plus one, 0 marks empty slots.
+ */
+#define ATTR_NAME(_, __, ___, ____, _fieldname, _____) #_fieldname,
+
+#define ATTR_COUNT THINGSBOARD_ATTRIBUTES_FIELD_COUNT
+#define ATTR_SLOTS (2 * ATTR_COUNT)
+
+BUILD_ASSERT(ATTR_COUNT < UINT16_MAX);
+
+static const char *const attr_names[ATTR_COUNT] = {
+	thingsboard_attributes_FIELDLIST(ATTR_NAME, NULL)};
+static uint16_t attr_slots[ATTR_SLOTS];
+
+/* FNV-1a */
+static uint32_t attr_hash(const char *key)
+{
+	uint32_t hash = 2166136261U;
+
+	for (; *key != 0; key++) {
+		hash = (hash ^ (uint8_t)*key) * 16777619U;
+	}
+
+	return hash;
+}
+
+const char *thingsboard_attributes_field_name(enum thingsboard_attributes_field field)
+{
+	if ((size_t)field >= ATTR_COUNT) {
+		return NULL;
+	}
+
+	return attr_names[field];
+}
+
+static int attr_lookup(const char *key)
+{
+	for (uint32_t slot = attr_hash(key) % ATTR_SLOTS; attr_slots[slot] != 0;
+	     slot = (slot + 1) % ATTR_SLOTS) {
+		int idx = attr_slots[slot] - 1;
+
+		if (strcmp(attr_names[idx], key) == 0) {
+			return idx;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static int attr_index_init(void)
+{
+	for (size_t i = 0; i < ATTR_COUNT; i++) {
+		uint32_t slot = attr_hash(attr_names[i]) % ATTR_SLOTS;
+
+		while (attr_slots[slot] != 0) {
+			slot = (slot + 1) % ATTR_SLOTS;
+		}
+		attr_slots[slot] = i + 1;
+	}
+
+	return 0;
+}
+
+SYS_INIT(attr_index_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+/* `string_v` is only ever copied into one of the string attributes, so it is decoded into a
+ * buffer the size of the largest one instead of a fixed size member of `KeyValueProto`.
+ */
+#define STRING_V_MEMBER_STRING(_fieldname)                                                         \
+	char _fieldname[sizeof(((thingsboard_attributes){})._fieldname)];
+#define STRING_V_MEMBER_UINT32(_fieldname)
+#define STRING_V_MEMBER_INT32(_fieldname)
+#define STRING_V_MEMBER_SINT32(_fieldname)
+#define STRING_V_MEMBER_UINT64(_fieldname)
+#define STRING_V_MEMBER_INT64(_fieldname)
+#define STRING_V_MEMBER_SINT64(_fieldname)
+#define STRING_V_MEMBER_BOOL(_fieldname)
+
+#define STRING_V_MEMBERS(_, __, ___, _type, _fieldname, ____) STRING_V_MEMBER_##_type(_fieldname)
+
+union string_v_buffer {
+	/* Keeps the union valid without any string attributes */
+	char empty[1];
+	thingsboard_attributes_FIELDLIST(STRING_V_MEMBERS, NULL)
+};
+
+/* Decode a string, truncating it to the size of the buffer in `arg` */
+static bool string_v_decode_cb(pb_istream_t *stream, const pb_field_t *field, void **arg)
+{
+	char *buffer = *arg;
+	size_t len = MIN(stream->bytes_left, sizeof(union string_v_buffer) - 1);
+
+	if (!pb_read(stream, buffer, len)) {
+		return false;
+	}
+	buffer[len] = 0;
+
+	/* Skip what does not fit */
+	return pb_read(stream, NULL, stream->bytes_left);
+}
+
+/* Decode results of `AttributeUpdateNotificationMsg` and `GetAttributeResponseMsg` */
+struct attributes_decode_ctx {
+	thingsboard_attributes *attributes;
+	uint32_t *deleted;
+	struct thingsboard_attributes_meta *meta;
+};
+
+/* Decode one shared attribute of `AttributeUpdateNotificationMsg` or `GetAttributeResponseMsg` */
 static bool attribute_decode_cb(pb_istream_t *stream, const pb_field_t *field, void **arg)
 {
-	thingsboard_attributes *v = *arg;
+	struct attributes_decode_ctx *ctx = *arg;
+	thingsboard_attributes *v = ctx->attributes;
+	char string_v[sizeof(union string_v_buffer)] = "";
 
 	TsKvProto tkp = TsKvProto_init_zero;
 
-	if (stream == NULL || field->tag != AttributeUpdateNotificationMsg_sharedUpdated_tag) {
+	if (stream == NULL) {
 		return true;
 	}
 
+	tkp.kv.string_v = (pb_callback_t){
+		.funcs.decode = string_v_decode_cb,
+		.arg = string_v,
+	};
+
 	if (!pb_decode(stream, TsKvProto_fields, &tkp)) {
 		return false;
 	}
 
 	if (tkp.has_kv) {
-		thingsboard_attributes_FIELDLIST(DECODE_ATTR_FIELDS, *v);
+		int idx = attr_lookup(tkp.kv.key);
+
+		if (idx >= 0 && !attr_is_newer(idx, &tkp)) {
+			LOG_DBG("Ignored stale update of attribute \"%s\"", tkp.kv.key);
+			return true;
+		}
+
+		switch (idx) {
+			thingsboard_attributes_FIELDLIST(DECODE_ATTR_FIELDS, *v)
+		default:
+			break;
+		}
 		LOG_WRN("Ignored unknown attribute \"%s\"", tkp.kv.key);
 	}
 
 	return true;
 }
 
+static bool attribute_deleted_decode_cb(pb_istream_t *stream, const pb_field_t *field, void **arg)
+{
+	struct attributes_decode_ctx *ctx = *arg;
+	char key[sizeof(((KeyValueProto){}).key)];
+
+	if (stream->bytes_left >= sizeof(key)) {
+		/* Can not be one of ours, all of them fit into `KeyValueProto.key` */
+		return pb_read(stream, NULL, stream->bytes_left);
+	}
+
+	size_t len = stream->bytes_left;
+
+	if (!pb_read(stream, key, len)) {
+		return false;
+	}
+	key[len] = 0;
+
+	int idx = attr_lookup(key);
+	if (idx < 0) {
+		LOG_DBG("Ignored deletion of unknown attribute \"%s\"", key);
+		return true;
+	}
+
+	/* The attribute might be created again later, with its version starting over */
+	ctx->meta->meta[idx] = (struct thingsboard_attribute_meta){0};
+	thingsboard_attributes_mask_set(ctx->meta->mask, idx);
+	thingsboard_attributes_mask_set(ctx->deleted, idx);
+
+	return true;
+}
+
 static int thingsboard_AttributeUpdateNotificationMsg_decode(const char *buffer, size_t len,
-							     thingsboard_attributes *v)
+							     thingsboard_attributes *v,
+							     uint32_t *deleted,
+							     struct thingsboard_attributes_meta *meta)
 {
+	struct attributes_decode_ctx ctx = {
+		.attributes = v,
+		.deleted = deleted,
+		.meta = meta,
+	};
 	AttributeUpdateNotificationMsg msg = {
 		.sharedUpdated =
 			{
-				.arg = v,
+				.arg = &ctx,
 				.funcs.decode = attribute_decode_cb,
 			},
+		.sharedDeleted =
+			{
+				.arg = &ctx,
+				.funcs.decode = attribute_deleted_decode_cb,
+			},
 	};
 	pb_istream_t stream = pb_istream_from_buffer(buffer, len);
 
@@ -162,7 +512,8 @@ static int thingsboard_AttributeUpdateNotificationMsg_decode(const char *buffer,
 	return 0;
 }
 
-int thingsboard_attributes_decode(const char *buffer, size_t len, thingsboard_attributes *v)
+int thingsboard_attributes_decode(const char *buffer, size_t len, thingsboard_attributes *v,
+				  uint32_t *deleted, struct thingsboard_attributes_meta *meta)
 {
 	*v = (thingsboard_attributes)thingsboard_attributes_init_zero;
 
@@ -179,13 +530,241 @@ int thingsboard_attributes_decode(const char *buffer, size_t len, thingsboard_at
 		PB_GET_ERROR(&stream));
 
 #endif /* CONFIG_THINGSBOARD_PROTOBUF_ATTRIBUTES_WORKAROUND_DEFAULT */
-	int err = thingsboard_AttributeUpdateNotificationMsg_decode(buffer, len, v);
+	int err = thingsboard_AttributeUpdateNotificationMsg_decode(buffer, len, v, deleted, meta);
 	if (err < 0) {
 		return -EFAULT;
 	}
 	return 0;
 }
 
+#ifdef CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE
+enum stream_state {
+	STREAM_KEY,
+	STREAM_VARINT,
+	STREAM_LENGTH,
+	STREAM_BYTES,
+};
+
+void thingsboard_attributes_stream_init(struct thingsboard_attributes_stream *s)
+{
+	*s = (struct thingsboard_attributes_stream){
+		.attributes = thingsboard_attributes_init_zero,
+		.state = STREAM_KEY,
+#ifdef CONFIG_THINGSBOARD_PROTOBUF_ATTRIBUTES_WORKAROUND_DEFAULT
+		.notification = true,
+#endif /* CONFIG_THINGSBOARD_PROTOBUF_ATTRIBUTES_WORKAROUND_DEFAULT */
+	};
+}
+
+/* Decode the buffered top level field and merge it into the stream */
+static int stream_decode_field(struct thingsboard_attributes_stream *s)
+{
+	size_t len = s->len;
+
+	s->state = STREAM_KEY;
+	s->shift = 0;
+	s->len = 0;
+
+	if (!s->notification) {
+		pb_istream_t stream = pb_istream_from_buffer(s->member, len);
+
+		if (pb_decode_ex(&stream, thingsboard_attributes_fields, &s->attributes,
+				 PB_DECODE_NOINIT)) {
+			return 0;
+		}
+
+		/* Fall back like thingsboard_attributes_decode(), for all remaining fields */
+		LOG_WRN("Failed to decode `thingsboard_attributes`: \"%s\" - Trying as "
+			"AttributeUpdateNotificationMsg",
+			PB_GET_ERROR(&stream));
+		s->notification = true;
+	}
+
+	int err = thingsboard_AttributeUpdateNotificationMsg_decode(s->member, len, &s->attributes,
+								    s->deleted, &s->meta);
+
+	return err < 0 ? -EBADMSG : 0;
+}
+
+/* Consume the varint byte `b`, returns 1 once the varint is complete */
+static int stream_varint(struct thingsboard_attributes_stream *s, uint8_t b, size_t *value)
+{
+	if (s->shift >= 35) {
+		return -EBADMSG;
+	}
+
+	if (value != NULL) {
+		*value |= (size_t)(b & 0x7f) << s->shift;
+	}
+	s->shift += 7;
+
+	return (b & 0x80) ? 0 : 1;
+}
+
+int thingsboard_attributes_stream_feed(struct thingsboard_attributes_stream *s, size_t offset,
+				       const char *data, size_t len)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	size_t i = 0;
+	int ret;
+
+	if (s->err < 0) {
+		return s->err;
+	}
+
+	if (offset != s->received) {
+		s->err = -EILSEQ;
+		return s->err;
+	}
+
+	while (i < len) {
+		if (s->state == STREAM_BYTES) {
+			/* Copy the value of length delimited and fixed size fields in one go */
+			size_t n = MIN(s->remaining, len - i);
+
+			if (n > sizeof(s->member) - s->len) {
+				ret = -EMSGSIZE;
+				goto fail;
+			}
+
+			memcpy(&s->member[s->len], &bytes[i], n);
+			s->len += n;
+			s->remaining -= n;
+			i += n;
+
+			ret = s->remaining == 0 ? stream_decode_field(s) : 0;
+			if (ret < 0) {
+				goto fail;
+			}
+			continue;
+		}
+
+		if (s->len >= sizeof(s->member)) {
+			ret = -EMSGSIZE;
+			goto fail;
+		}
+
+		uint8_t b = bytes[i++];
+
+		s->member[s->len++] = b;
+
+		switch (s->state) {
+		case STREAM_KEY:
+			ret = stream_varint(s, b, NULL);
+			if (ret <= 0) {
+				break;
+			}
+
+			s->shift = 0;
+			s->remaining = 0;
+
+			switch ((pb_wire_type_t)(s->member[0] & 0x07)) {
+			case PB_WT_VARINT:
+				s->state = STREAM_VARINT;
+				break;
+			case PB_WT_64BIT:
+				s->remaining = 8;
+				s->state = STREAM_BYTES;
+				break;
+			case PB_WT_32BIT:
+				s->remaining = 4;
+				s->state = STREAM_BYTES;
+				break;
+			case PB_WT_STRING:
+				s->state = STREAM_LENGTH;
+				break;
+			default:
+				ret = -EBADMSG;
+				break;
+			}
+			break;
+		case STREAM_VARINT:
+			ret = stream_varint(s, b, NULL);
+			if (ret > 0) {
+				ret = stream_decode_field(s);
+			}
+			break;
+		case STREAM_LENGTH:
+			ret = stream_varint(s, b, &s->remaining);
+			if (ret <= 0) {
+				break;
+			}
+
+			if (s->remaining > sizeof(s->member) - s->len) {
+				ret = -EMSGSIZE;
+			} else if (s->remaining == 0) {
+				ret = stream_decode_field(s);
+			} else {
+				s->state = STREAM_BYTES;
+			}
+			break;
+		default:
+			ret = -EFAULT;
+			break;
+		}
+
+		if (ret < 0) {
+			goto fail;
+		}
+	}
+
+	s->received += len;
+
+	return 0;
+
+fail:
+	s->err = ret;
+	return ret;
+}
+
+int thingsboard_attributes_stream_finish(struct thingsboard_attributes_stream *s)
+{
+	if (s->err < 0) {
+		return s->err;
+	}
+
+	/* The last field has to be complete */
+	if (s->received == 0 || s->state != STREAM_KEY || s->len != 0) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE */
+
+int thingsboard_attributes_response_decode(const char *buffer, size_t len,
+					   thingsboard_attributes *v,
+					   struct thingsboard_attributes_meta *meta)
+{
+	struct attributes_decode_ctx ctx = {
+		.attributes = v,
+		.meta = meta,
+	};
+	GetAttributeResponseMsg msg = {
+		.sharedAttributeList =
+			{
+				.arg = &ctx,
+				.funcs.decode = attribute_decode_cb,
+			},
+	};
+	pb_istream_t stream = pb_istream_from_buffer(buffer, len);
+
+	*v = (thingsboard_attributes)thingsboard_attributes_init_zero;
+
+	bool success = pb_decode(&stream, GetAttributeResponseMsg_fields, &msg);
+	if (!success) {
+		LOG_WRN("Failed to decode `GetAttributeResponseMsg`: %s", PB_GET_ERROR(&stream));
+		return -EFAULT;
+	}
+
+	if (msg.error[0] != 0) {
+		LOG_ERR("Fetching attributes failed: %s", msg.error);
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
 int thingsboard_rpc_response_decode(const char *buffer, size_t len, thingsboard_rpc_response *rr)
 {
 	*rr = (thingsboard_rpc_response)thingsboard_rpc_response_init_zero;
@@ -241,6 +820,18 @@ struct timeseries_encode_ctx {
 	size_t encoded;
 };
 
+static size_t varint_size(uint64_t value)
+{
+	size_t size = 1;
+
+	while (value >= 0x80) {
+		value >>= 7;
+		size++;
+	}
+
+	return size;
+}
+
 static bool timeseries_encode_cb(pb_ostream_t *stream, const pb_field_t *field, void *const *arg)
 {
 	struct timeseries_encode_ctx *ctx = *arg;
@@ -262,11 +853,37 @@ static bool timeseries_encode_cb(pb_ostream_t *stream, const pb_field_t *field,
 int thingsboard_timeseries_encode(const thingsboard_timeseries *ts, size_t *ts_count, char *buffer,
 				  size_t *len)
 {
+	/* The list only consists of the repeated field, so its encoded size is
+	 * the sum of the entries, each prefixed by tag and length. Find out
+	 * how many entries fit beforehand, to be able to split like the JSON
+	 * encoder does.
+	 */
+	const size_t tag_size =
+		varint_size((uint64_t)thingsboard_timeseries_list_values_tag << 3);
+	size_t total = 0;
+	size_t count = 0;
+
+	for (; count < *ts_count; count++) {
+		size_t entry_size;
+
+		if (!pb_get_encoded_size(&entry_size, thingsboard_timeseries_fields, &ts[count])) {
+			LOG_WRN("Failed to size `thingsboard_timeseries`");
+			return -EFAULT;
+		}
+
+		entry_size += tag_size + varint_size(entry_size);
+		if (total + entry_size > *len) {
+			break;
+		}
+
+		total += entry_size;
+	}
+
 	pb_ostream_t stream = pb_ostream_from_buffer(buffer, *len);
 
 	struct timeseries_encode_ctx ctx = {
 		.ts = ts,
-		.count = *ts_count,
+		.count = count,
 	};
 
 	thingsboard_timeseries_list ts_list = {
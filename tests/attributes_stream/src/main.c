@@ -0,0 +1,206 @@
+#include <string.h>
+
+#include <thingsboard.h>
+#include <zephyr/ztest.h>
+
+#include "tb_internal.h"
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+
+/* Shared attribute update, as sent by Thingsboard */
+static const char update[] = "{\"fw_title\":\"abc\",\"fw_version\":\"1.2.3\",\"fw_size\":1234}";
+
+/* Deletion of `fw_version` */
+static const char deletion[] = "{\"deleted\":[\"fw_version\"]}";
+
+/* Start of a notification with a member larger than the decoder buffer */
+static size_t oversize_notification(char *buf, size_t size)
+{
+	size_t len = strlen("{\"fw_title\":\"");
+
+	memcpy(buf, "{\"fw_title\":\"", len);
+	memset(buf + len, 'a', size - len);
+
+	return size;
+}
+
+#else /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+/* Shared attribute update and deletion in one `AttributeUpdateNotificationMsg` */
+static const char update[] =
+	/* sharedUpdated { ts: 1, kv { key: "fw_title", type: STRING_V, string_v: "abc" } } */
+	"\x0a\x15\x08\x01\x12\x11\x0a\x08" "fw_title" "\x10\x03\x32\x03" "abc"
+	/* sharedUpdated { ts: 1, kv { key: "fw_size", type: LONG_V, long_v: 1234 } } */
+	"\x0a\x12\x08\x01\x12\x0e\x0a\x07" "fw_size" "\x10\x01\x20\xd2\x09"
+	/* sharedDeleted: "fw_version" */
+	"\x12\x0a" "fw_version";
+
+/* Deletion of `fw_version` only */
+static const char deletion[] = "\x12\x0a" "fw_version";
+
+/* Start of a notification with a field larger than the decoder buffer */
+static size_t oversize_notification(char *buf, size_t size)
+{
+	size_t len = 0;
+
+	memset(buf, 0, size);
+
+	/* sharedUpdated with as many bytes as the buffer holds */
+	buf[len++] = 0x0a;
+	for (uint32_t v = CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE_MEMBER_SIZE; v != 0; v >>= 7) {
+		buf[len++] = (v & 0x7f) | (v >= 0x80 ? 0x80 : 0);
+	}
+
+	return size;
+}
+
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+static struct thingsboard_attributes_stream stream;
+
+/* Decode `msg` in two blocks, split at `split` */
+static int decode_split(const char *msg, size_t len, size_t split)
+{
+	int err;
+
+	thingsboard_attributes_stream_init(&stream);
+
+	err = thingsboard_attributes_stream_feed(&stream, 0, msg, split);
+	if (err < 0) {
+		return err;
+	}
+
+	err = thingsboard_attributes_stream_feed(&stream, split, msg + split, len - split);
+	if (err < 0) {
+		return err;
+	}
+
+	return thingsboard_attributes_stream_finish(&stream);
+}
+
+static bool deleted(enum thingsboard_attributes_field field)
+{
+	return thingsboard_attributes_mask_test(stream.deleted, field);
+}
+
+ZTEST(attributes_stream, test_update_every_split)
+{
+	size_t len = sizeof(update) - 1;
+
+	for (size_t split = 0; split <= len; split++) {
+		zassert_ok(decode_split(update, len, split), "split at %zu", split);
+
+		zassert_true(stream.attributes.has_fw_title, "split at %zu", split);
+		zassert_equal(strcmp(stream.attributes.fw_title, "abc"), 0, "split at %zu", split);
+		zassert_true(stream.attributes.has_fw_size, "split at %zu", split);
+		zassert_equal(stream.attributes.fw_size, 1234, "split at %zu", split);
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+		zassert_true(stream.attributes.has_fw_version, "split at %zu", split);
+		zassert_equal(strcmp(stream.attributes.fw_version, "1.2.3"), 0, "split at %zu",
+			      split);
+		zassert_false(deleted(THINGSBOARD_ATTRIBUTES_FIELD_fw_version), "split at %zu",
+			      split);
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+		zassert_false(stream.attributes.has_fw_version, "split at %zu", split);
+		zassert_true(deleted(THINGSBOARD_ATTRIBUTES_FIELD_fw_version), "split at %zu",
+			     split);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+		zassert_false(deleted(THINGSBOARD_ATTRIBUTES_FIELD_fw_title), "split at %zu",
+			      split);
+	}
+}
+
+ZTEST(attributes_stream, test_deletion_every_split)
+{
+	size_t len = sizeof(deletion) - 1;
+
+	for (size_t split = 0; split <= len; split++) {
+		zassert_ok(decode_split(deletion, len, split), "split at %zu", split);
+
+		zassert_false(stream.attributes.has_fw_title, "split at %zu", split);
+		zassert_false(stream.attributes.has_fw_version, "split at %zu", split);
+		zassert_true(deleted(THINGSBOARD_ATTRIBUTES_FIELD_fw_version), "split at %zu",
+			     split);
+		zassert_false(deleted(THINGSBOARD_ATTRIBUTES_FIELD_fw_title), "split at %zu",
+			      split);
+	}
+}
+
+ZTEST(attributes_stream, test_byte_blocks)
+{
+	size_t len = sizeof(update) - 1;
+
+	thingsboard_attributes_stream_init(&stream);
+
+	for (size_t i = 0; i < len; i++) {
+		zassert_ok(thingsboard_attributes_stream_feed(&stream, i, update + i, 1),
+			   "byte %zu", i);
+	}
+
+	zassert_ok(thingsboard_attributes_stream_finish(&stream));
+	zassert_equal(strcmp(stream.attributes.fw_title, "abc"), 0);
+	zassert_equal(stream.attributes.fw_size, 1234);
+}
+
+ZTEST(attributes_stream, test_truncated)
+{
+	size_t len = sizeof(update) - 1;
+
+	thingsboard_attributes_stream_init(&stream);
+	zassert_equal(thingsboard_attributes_stream_finish(&stream), -EBADMSG);
+
+	/* The last member or field is incomplete */
+	zassert_ok(thingsboard_attributes_stream_feed(&stream, 0, update, len - 1));
+	zassert_equal(thingsboard_attributes_stream_finish(&stream), -EBADMSG);
+}
+
+ZTEST(attributes_stream, test_out_of_order)
+{
+	size_t len = sizeof(update) - 1;
+	size_t split = len / 2;
+
+	/* The second block arrives first */
+	thingsboard_attributes_stream_init(&stream);
+	zassert_equal(thingsboard_attributes_stream_feed(&stream, split, update + split,
+							 len - split),
+		      -EILSEQ);
+	zassert_equal(thingsboard_attributes_stream_feed(&stream, 0, update, split), -EILSEQ);
+	zassert_equal(thingsboard_attributes_stream_finish(&stream), -EILSEQ);
+
+	/* A block is repeated */
+	thingsboard_attributes_stream_init(&stream);
+	zassert_ok(thingsboard_attributes_stream_feed(&stream, 0, update, split));
+	zassert_equal(thingsboard_attributes_stream_feed(&stream, 0, update, split), -EILSEQ);
+	zassert_equal(thingsboard_attributes_stream_finish(&stream), -EILSEQ);
+
+	/* A block is missing */
+	thingsboard_attributes_stream_init(&stream);
+	zassert_ok(thingsboard_attributes_stream_feed(&stream, 0, update, 1));
+	zassert_equal(thingsboard_attributes_stream_feed(&stream, 2, update + 2, len - 2),
+		      -EILSEQ);
+	zassert_equal(thingsboard_attributes_stream_finish(&stream), -EILSEQ);
+}
+
+ZTEST(attributes_stream, test_oversize)
+{
+	static char buf[2 * CONFIG_THINGSBOARD_ATTRIBUTES_BLOCKWISE_MEMBER_SIZE];
+	size_t len = oversize_notification(buf, sizeof(buf));
+	int err = 0;
+
+	thingsboard_attributes_stream_init(&stream);
+
+	/* Fed in small blocks, the error shows once the buffer overflows */
+	for (size_t offset = 0; offset < len && err == 0; offset += 16) {
+		err = thingsboard_attributes_stream_feed(&stream, offset, buf + offset,
+							 MIN(16, len - offset));
+	}
+
+	zassert_equal(err, -EMSGSIZE);
+	zassert_equal(thingsboard_attributes_stream_finish(&stream), -EMSGSIZE);
+
+	/* The decoder can be reused for the next notification */
+	zassert_ok(decode_split(update, sizeof(update) - 1, 0));
+}
+
+ZTEST_SUITE(attributes_stream, NULL, NULL, NULL, NULL, NULL);
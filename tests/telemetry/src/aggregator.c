@@ -0,0 +1,161 @@
+#include <string.h>
+
+#include <thingsboard.h>
+#include <zephyr/ztest.h>
+
+#include "fakes.h"
+#include "tb_internal.h"
+
+#define MAX_ENTRIES CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR_MAX_ENTRIES
+#define TS          1700000000000LL
+
+/* Samples differ in the length of their state, so batches can be sized to the byte */
+static const char state[] = "abcdefghijk";
+#define MAX_STATE_LEN (sizeof(state) - 1)
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+static void set_state(thingsboard_telemetry *telemetry, size_t len)
+{
+	static char buffers[MAX_ENTRIES + 1][sizeof(state)];
+	static size_t next;
+	char *buf = buffers[next++ % ARRAY_SIZE(buffers)];
+
+	memcpy(buf, state, len);
+	buf[len] = 0;
+	telemetry->fw_state = buf;
+	telemetry->has_fw_state = true;
+}
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+static void set_state(thingsboard_telemetry *telemetry, size_t len)
+{
+	memcpy(telemetry->fw_state, state, len);
+	telemetry->fw_state[len] = 0;
+	telemetry->has_fw_state = true;
+}
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+static void record(size_t len)
+{
+	thingsboard_telemetry telemetry = {0};
+
+	set_state(&telemetry, len);
+	zassert_ok(thingsboard_record_telemetry(&telemetry));
+}
+
+/* Samples as recorded with the state lengths in `lens` */
+static thingsboard_timeseries samples[MAX_ENTRIES + 1];
+static size_t lens[MAX_ENTRIES + 1];
+
+/* The first `count` samples fit into one message */
+static bool fits(size_t count)
+{
+	static char buffer[CONFIG_COAP_CLIENT_MESSAGE_SIZE];
+	size_t len = sizeof(buffer);
+	size_t n = count;
+
+	for (size_t i = 0; i < count; i++) {
+		samples[i] = (thingsboard_timeseries){.ts = TS, .has_values = true};
+		set_state(&samples[i].values, lens[i]);
+	}
+
+	zassert_ok(thingsboard_timeseries_encode(samples, &n, buffer, &len));
+
+	return n == count;
+}
+
+/* Choose `lens`, so the first `count` samples fill a message to the last byte */
+static size_t fill_message(void)
+{
+	size_t count = 0;
+
+	/* Samples of maximum length, as many as fit */
+	do {
+		lens[count++] = MAX_STATE_LEN;
+	} while (count < MAX_ENTRIES && fits(count));
+	lens[--count] = 1;
+
+	/* Shorten the first samples one byte at a time, until a last sample fits exactly */
+	for (size_t shorten = 0;; shorten++) {
+		for (size_t len = 1; len < MAX_STATE_LEN; len++) {
+			lens[count] = len + 1;
+			bool longer_fits = fits(count + 1);
+
+			lens[count] = len;
+			if (fits(count + 1) && !longer_fits) {
+				return count + 1;
+			}
+		}
+
+		if (shorten == count * (MAX_STATE_LEN - 1)) {
+			break;
+		}
+		lens[shorten % count] = MAX_STATE_LEN - 1 - shorten / count;
+	}
+
+	ztest_test_fail();
+	return 0;
+}
+
+static void aggregator_before(void *fixture)
+{
+	fake_time_msec = TS;
+	fake_reset();
+	zassert_ok(thingsboard_flush_telemetry());
+	fake_reset();
+}
+
+ZTEST(telemetry_aggregator, test_exact_fit)
+{
+	size_t count = fill_message();
+
+	for (size_t i = 0; i < count; i++) {
+		record(lens[i]);
+	}
+
+	/* The batch fills the message, but it is only sent with the next sample */
+	zassert_equal(fake_batch_count, 0);
+
+	record(1);
+
+	zassert_equal(fake_batch_count, 1);
+	zassert_equal(fake_batches[0].count, count);
+}
+
+ZTEST(telemetry_aggregator, test_one_byte_over)
+{
+	size_t count = fill_message();
+
+	for (size_t i = 0; i + 1 < count; i++) {
+		record(lens[i]);
+	}
+	zassert_equal(fake_batch_count, 0);
+
+	/* The last sample does not fit anymore, when one byte longer */
+	record(lens[count - 1] + 1);
+
+	zassert_equal(fake_batch_count, 1);
+	zassert_equal(fake_batches[0].count, count - 1);
+}
+
+ZTEST(telemetry_aggregator, test_flush)
+{
+	/* Nothing to send */
+	zassert_ok(thingsboard_flush_telemetry());
+	zassert_equal(fake_batch_count, 0);
+
+	for (size_t len = 1; len <= 3; len++) {
+		record(len);
+	}
+	zassert_equal(fake_batch_count, 0);
+
+	zassert_ok(thingsboard_flush_telemetry());
+	zassert_equal(fake_batch_count, 1);
+	zassert_equal(fake_batches[0].count, 3);
+
+	/* The samples are kept in order, including their strings */
+	for (size_t i = 0; i < 3; i++) {
+		zassert_equal(strlen(fake_batches[0].entries[i].values.fw_state), i + 1);
+	}
+}
+
+ZTEST_SUITE(telemetry_aggregator, NULL, NULL, aggregator_before, NULL, NULL);
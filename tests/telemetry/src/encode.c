@@ -0,0 +1,273 @@
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include <thingsboard.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/ztest.h>
+
+#include "tb_internal.h"
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+/* The JSON encoder terminates its output */
+#define TERMINATOR 1
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+#define TERMINATOR 0
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+static char buffer[1024];
+
+static thingsboard_timeseries entries[8];
+
+static void entries_init(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		entries[i] = (thingsboard_timeseries){
+			.ts = 1700000000000LL + i * 1000,
+			.has_values = true,
+		};
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+		entries[i].values.fw_state = &"DOWNLOADING"[i];
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+		strcpy(entries[i].values.fw_state, &"DOWNLOADING"[i]);
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+		entries[i].values.has_fw_state = true;
+	}
+}
+
+/* Encoded length of the first `count` entries */
+static size_t encoded_len(size_t count)
+{
+	size_t len = sizeof(buffer);
+	size_t n = count;
+
+	zassert_ok(thingsboard_timeseries_encode(entries, &n, buffer, &len));
+	zassert_equal(n, count);
+
+	return len;
+}
+
+ZTEST(telemetry_encode, test_split_at_every_size)
+{
+	size_t full_len = encoded_len(ARRAY_SIZE(entries));
+
+	zassert_true(full_len + TERMINATOR <= sizeof(buffer));
+
+	for (size_t size = 0; size <= full_len + TERMINATOR; size++) {
+		size_t n = ARRAY_SIZE(entries);
+		size_t len = size;
+		int err = thingsboard_timeseries_encode(entries, &n, buffer, &len);
+
+		if (err == -ENOMEM) {
+			/* Not even an empty list fits */
+			zassert_true(size < encoded_len(0) + TERMINATOR, "size %zu", size);
+			continue;
+		}
+		zassert_ok(err, "size %zu", size);
+
+		/* As many entries as fit, and no more */
+		zassert_true(len + TERMINATOR <= size, "size %zu", size);
+		zassert_equal(len, encoded_len(n), "size %zu", size);
+		if (n < ARRAY_SIZE(entries)) {
+			zassert_true(encoded_len(n + 1) + TERMINATOR > size, "size %zu", size);
+		}
+	}
+}
+
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+
+ZTEST(telemetry_encode, test_timeseries_json)
+{
+	static const char expected[] =
+		"[{\"ts\":1,\"values\":{\"fw_state\":\"abc\"}},"
+		"{\"ts\":-9223372036854775808,\"values\":{}}]";
+	thingsboard_timeseries ts[] = {
+		{.ts = 1, .has_values = true, .values = {.has_fw_state = true, .fw_state = "abc"}},
+		{.ts = INT64_MIN},
+	};
+	size_t n = ARRAY_SIZE(ts);
+	size_t len = sizeof(buffer);
+
+	zassert_ok(thingsboard_timeseries_encode(ts, &n, buffer, &len));
+	zassert_equal(n, ARRAY_SIZE(ts));
+	zassert_equal(len, sizeof(expected) - 1);
+	zassert_mem_equal(buffer, expected, sizeof(expected));
+}
+
+ZTEST(telemetry_encode, test_timeseries_json_empty)
+{
+	size_t n = 0;
+	size_t len = 3;
+
+	zassert_ok(thingsboard_timeseries_encode(entries, &n, buffer, &len));
+	zassert_equal(len, 2);
+	zassert_mem_equal(buffer, "[]", 3);
+
+	/* The first entry does not fit, nothing is encoded */
+	n = 1;
+	len = 3;
+	zassert_ok(thingsboard_timeseries_encode(entries, &n, buffer, &len));
+	zassert_equal(n, 0);
+	zassert_mem_equal(buffer, "[]", 3);
+}
+
+ZTEST(telemetry_encode, test_telemetry_json_exact_fit)
+{
+	static const char expected[] = "{\"fw_state\":\"abc\",\"current_fw_version\":\"1.2\"}";
+	thingsboard_telemetry telemetry = {
+		.has_fw_state = true,
+		.fw_state = "abc",
+		.has_current_fw_version = true,
+		.current_fw_version = "1.2",
+	};
+	size_t len = sizeof(expected);
+
+	zassert_ok(thingsboard_telemetry_encode(&telemetry, buffer, &len));
+	zassert_equal(len, sizeof(expected) - 1);
+	zassert_mem_equal(buffer, expected, sizeof(expected));
+
+	/* No room for the terminator */
+	len = sizeof(expected) - 1;
+	zassert_equal(thingsboard_telemetry_encode(&telemetry, buffer, &len), -EINVAL);
+}
+
+ZTEST(telemetry_encode, test_string_escaping)
+{
+	static const char expected[] = "{\"current_fw_title\":"
+				       "\"a\\\"b\\\\c \\b\\f\\n\\r\\t\\u0001\\u001f/\xc3\xa9\"}";
+	thingsboard_telemetry telemetry = {
+		.has_current_fw_title = true,
+		.current_fw_title = "a\"b\\c \b\f\n\r\t\x01\x1f/\xc3\xa9",
+	};
+	size_t len = sizeof(buffer);
+
+	zassert_ok(thingsboard_telemetry_encode(&telemetry, buffer, &len));
+	zassert_equal(len, sizeof(expected) - 1);
+	zassert_mem_equal(buffer, expected, sizeof(expected));
+}
+
+ZTEST(telemetry_encode, test_optional_members)
+{
+	thingsboard_telemetry telemetry = {0};
+	size_t len = sizeof(buffer);
+
+	zassert_ok(thingsboard_telemetry_encode(&telemetry, buffer, &len));
+	zassert_mem_equal(buffer, "{}", 3);
+
+	/* No separator in front of the first member, even if it is not the first one */
+	telemetry.has_current_fw_version = true;
+	telemetry.current_fw_version = "1";
+	len = sizeof(buffer);
+	zassert_ok(thingsboard_telemetry_encode(&telemetry, buffer, &len));
+	zassert_mem_equal(buffer, "{\"current_fw_version\":\"1\"}", len + 1);
+}
+
+ZTEST(telemetry_encode, test_truncated_output)
+{
+	thingsboard_telemetry telemetry = {
+		.has_fw_state = true,
+		.fw_state = "\n\n",
+		.has_current_fw_title = true,
+		.current_fw_title = "title",
+	};
+	size_t full_len = sizeof(buffer);
+
+	zassert_ok(thingsboard_telemetry_encode(&telemetry, buffer, &full_len));
+
+	/* Every buffer too small fails, without writing past its end */
+	for (size_t size = 0; size <= full_len; size++) {
+		size_t len = size;
+
+		memset(buffer, 0x55, sizeof(buffer));
+		zassert_equal(thingsboard_telemetry_encode(&telemetry, buffer, &len), -EINVAL,
+			      "size %zu", size);
+		zassert_equal(buffer[size], 0x55, "size %zu", size);
+	}
+}
+
+/* The members below are added by schema/test_telemetry.jsonschema */
+static void assert_encoded(const thingsboard_telemetry *telemetry, const char *expected)
+{
+	size_t len = sizeof(buffer);
+
+	zassert_ok(thingsboard_telemetry_encode(telemetry, buffer, &len));
+	zassert_equal(len, strlen(expected), "%s", expected);
+	zassert_mem_equal(buffer, expected, len + 1, "%s", expected);
+}
+
+ZTEST(telemetry_encode, test_double)
+{
+	static const struct {
+		double value;
+		const char *expected;
+	} cases[] = {
+		/* Fixed-point, without trailing zeros */
+		{0.0, "0"},
+		{-0.0, "0"},
+		{1.0, "1"},
+		{-1.5, "-1.5"},
+		{0.1, "0.1"},
+		{0.001, "0.001"},
+		{123.456789, "123.456789"},
+		{123.4567894, "123.456789"},
+		{1.0000005, "1.000001"},
+		{0.9999996, "1"},
+		{8589934592.25, "8589934592.25"},
+		{9999999999999.0, "9999999999999"},
+		{9999999999999.5, "9999999999999.5"},
+		/* Exponent notation with seven significant digits */
+		{1e13, "1e13"},
+		{12345678901234567.0, "1.234568e16"},
+		{1e300, "1e300"},
+		{0.000999, "9.99e-4"},
+		{0.0009999999, "9.999999e-4"},
+		{-2.5e-7, "-2.5e-7"},
+		/* Rounding carries over into the exponent */
+		{99999999999999.99, "1e14"},
+		/* Not representable in JSON */
+		{NAN, "null"},
+		{INFINITY, "null"},
+		{-INFINITY, "null"},
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		char expected[64];
+		thingsboard_telemetry telemetry = {
+			.has_temperature = true,
+			.temperature = cases[i].value,
+		};
+
+		snprintk(expected, sizeof(expected), "{\"temperature\":%s}", cases[i].expected);
+		assert_encoded(&telemetry, expected);
+	}
+}
+
+ZTEST(telemetry_encode, test_int64_bool)
+{
+	thingsboard_telemetry telemetry = {
+		.has_count = true,
+		.count = INT64_MIN,
+		.has_valid = true,
+		.valid = false,
+	};
+
+	assert_encoded(&telemetry, "{\"count\":-9223372036854775808,\"valid\":false}");
+
+	telemetry.count = INT64_MAX;
+	telemetry.valid = true;
+	assert_encoded(&telemetry, "{\"count\":9223372036854775807,\"valid\":true}");
+
+	telemetry.count = 0;
+	assert_encoded(&telemetry, "{\"count\":0,\"valid\":true}");
+}
+
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+
+static void *encode_setup(void)
+{
+	entries_init();
+
+	return NULL;
+}
+
+ZTEST_SUITE(telemetry_encode, NULL, encode_setup, NULL, NULL, NULL);
@@ -0,0 +1,114 @@
+#include <errno.h>
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
+#include <thingsboard.h>
+
+#include "fakes.h"
+#include "tb_internal.h"
+
+bool fake_active;
+size_t fake_max_entries;
+size_t fake_eio_after;
+int64_t fake_sent_ts[FAKE_MAX_SENT];
+size_t fake_sent_count;
+size_t fake_calls[FAKE_MAX_CALLS];
+size_t fake_call_count;
+int64_t fake_time_msec;
+struct fake_batch fake_batches[FAKE_MAX_BATCHES];
+size_t fake_batch_count;
+
+void fake_reset(void)
+{
+	fake_active = true;
+	fake_max_entries = SIZE_MAX;
+	fake_eio_after = SIZE_MAX;
+	fake_sent_count = 0;
+	fake_call_count = 0;
+	fake_batch_count = 0;
+}
+
+static void fake_send(const thingsboard_timeseries *ts, size_t count)
+{
+	/* Called from the work queue, the counts are checked by the tests instead */
+	for (size_t i = 0; i < count; i++, fake_sent_count++) {
+		if (fake_sent_count < FAKE_MAX_SENT) {
+			fake_sent_ts[fake_sent_count] = ts[i].ts;
+		}
+	}
+}
+
+bool __wrap_thingsboard_is_active(void)
+{
+	return fake_active;
+}
+
+int __wrap_thingsboard_send_timeseries_direct(const thingsboard_timeseries *ts, size_t ts_count,
+					      bool confirmable, bool persist,
+					      thingsboard_delivery_callback_t cb, void *user_data,
+					      size_t *sent)
+{
+	if (fake_call_count < FAKE_MAX_CALLS) {
+		fake_calls[fake_call_count] = ts_count;
+	}
+	fake_call_count++;
+
+	if (sent != NULL) {
+		*sent = 0;
+	}
+
+	if (ts_count > fake_max_entries) {
+		return -ENOMEM;
+	}
+
+	if (ts_count > fake_eio_after) {
+		/* Fails only once */
+		fake_send(ts, fake_eio_after);
+		if (sent != NULL) {
+			*sent = fake_eio_after;
+		}
+		fake_eio_after = SIZE_MAX;
+		return -EIO;
+	}
+
+	fake_send(ts, ts_count);
+	if (sent != NULL) {
+		*sent = ts_count;
+	}
+
+	return 0;
+}
+
+int64_t __wrap_thingsboard_time_msec(void)
+{
+	return fake_time_msec;
+}
+
+int __wrap_thingsboard_send_timeseries(const thingsboard_timeseries *ts, size_t ts_count)
+{
+	if (fake_batch_count >= FAKE_MAX_BATCHES) {
+		fake_batch_count++;
+		return 0;
+	}
+
+	struct fake_batch *batch = &fake_batches[fake_batch_count++];
+
+	batch->count = MIN(ts_count, ARRAY_SIZE(batch->entries));
+
+	/* The aggregator reuses its entries, so strings have to be copied as well */
+	for (size_t i = 0; i < batch->count; i++) {
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+		batch->entries[i] = (thingsboard_timeseries){
+			.ts = ts[i].ts,
+			.has_values = ts[i].has_values,
+		};
+		(void)thingsboard_telemetry_update_with_buffer(
+			&ts[i].values, &batch->entries[i].values, &batch->buffers[i], NULL);
+#else  /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+		batch->entries[i] = ts[i];
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	}
+
+	return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef _FAKES_H_
+#define _FAKES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <thingsboard.h>
+
+#define FAKE_MAX_SENT    64
+#define FAKE_MAX_CALLS   64
+#define FAKE_MAX_BATCHES 2
+
+/* Returned by `thingsboard_is_active()` */
+extern bool fake_active;
+
+/* Sending more entries at once fails with -ENOMEM, like running out of requests */
+extern size_t fake_max_entries;
+
+/* The next send fails with -EIO after this many entries, SIZE_MAX to never fail */
+extern size_t fake_eio_after;
+
+/* Timestamps of all entries sent, in order. Only the first FAKE_MAX_SENT are stored. */
+extern int64_t fake_sent_ts[FAKE_MAX_SENT];
+extern size_t fake_sent_count;
+
+/* Number of entries passed to each call, including failed calls. Only the first
+ * FAKE_MAX_CALLS are stored.
+ */
+extern size_t fake_calls[FAKE_MAX_CALLS];
+extern size_t fake_call_count;
+
+/* Returned by `thingsboard_time_msec()` */
+extern int64_t fake_time_msec;
+
+/* Copies of the timeseries passed to `thingsboard_send_timeseries()` */
+#define FAKE_MAX_BATCH_ENTRIES CONFIG_THINGSBOARD_TELEMETRY_AGGREGATOR_MAX_ENTRIES
+
+struct fake_batch {
+	thingsboard_timeseries entries[FAKE_MAX_BATCH_ENTRIES];
+#ifdef CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON
+	struct thingsboard_telemetry_buffer buffers[FAKE_MAX_BATCH_ENTRIES];
+#endif /* CONFIG_THINGSBOARD_CONTENT_FORMAT_JSON */
+	size_t count;
+};
+
+extern struct fake_batch fake_batches[FAKE_MAX_BATCHES];
+extern size_t fake_batch_count;
+
+void fake_reset(void);
+
+#endif /* _FAKES_H_ */
@@ -0,0 +1,170 @@
+#include <errno.h>
+
+#include <thingsboard.h>
+#include <zephyr/ztest.h>
+
+#include "fakes.h"
+#include "tb_internal.h"
+
+#define QUEUE_SIZE CONFIG_THINGSBOARD_TELEMETRY_QUEUE_SIZE
+
+/* Timestamp of the next entry, so every entry can be told apart */
+static int64_t next_ts = 1;
+
+static int put(size_t count)
+{
+	thingsboard_timeseries ts[QUEUE_SIZE + 2] = {0};
+
+	zassert_true(count <= ARRAY_SIZE(ts));
+
+	for (size_t i = 0; i < count; i++) {
+		ts[i].ts = next_ts++;
+	}
+
+	return thingsboard_telemetry_queue_put(ts, count);
+}
+
+/* Run the drain work, which is submitted to the system work queue */
+static void drain(void)
+{
+	thingsboard_telemetry_queue_drain();
+	k_sleep(K_MSEC(10));
+}
+
+/* Check that the entries from `first_ts` on have been sent once, in order */
+static void assert_sent(int64_t first_ts, size_t count)
+{
+	zassert_equal(fake_sent_count, count);
+	for (size_t i = 0; i < count; i++) {
+		zassert_equal(fake_sent_ts[i], first_ts + i, "entry %zu", i);
+	}
+}
+
+static void queue_before(void *fixture)
+{
+	/* Start every test with an empty queue */
+	fake_reset();
+	drain();
+	zassert_true(thingsboard_telemetry_queue_is_empty());
+	fake_reset();
+}
+
+ZTEST(telemetry_queue, test_drop_policy)
+{
+	int64_t first_ts = next_ts;
+	int err = put(QUEUE_SIZE + 2);
+
+	zassert_equal(thingsboard_telemetry_queue_count(), QUEUE_SIZE);
+
+	drain();
+
+	zassert_true(thingsboard_telemetry_queue_is_empty());
+	if (IS_ENABLED(CONFIG_THINGSBOARD_TELEMETRY_QUEUE_DROP_NEWEST)) {
+		zassert_equal(err, -ENOSPC);
+		assert_sent(first_ts, QUEUE_SIZE);
+	} else {
+		zassert_ok(err);
+		assert_sent(first_ts + 2, QUEUE_SIZE);
+	}
+}
+
+ZTEST(telemetry_queue, test_wrap_around)
+{
+	bool wrapped = false;
+
+	/* The start of the queue moves through every slot */
+	for (size_t round = 0; round <= QUEUE_SIZE; round++) {
+		int64_t first_ts = next_ts;
+
+		fake_reset();
+		zassert_ok(put(QUEUE_SIZE));
+		drain();
+
+		assert_sent(first_ts, QUEUE_SIZE);
+		/* Entries are sent in one message, unless they wrap around the end of the ring */
+		zassert_true(fake_call_count <= 2, "round %zu", round);
+		wrapped |= fake_call_count == 2;
+	}
+
+	zassert_true(wrapped);
+}
+
+ZTEST(telemetry_queue, test_chunk_halving)
+{
+	int64_t first_ts = next_ts;
+
+	fake_max_entries = 1;
+	zassert_ok(put(QUEUE_SIZE));
+	drain();
+
+	zassert_true(thingsboard_telemetry_queue_is_empty());
+	assert_sent(first_ts, QUEUE_SIZE);
+	zassert_true(fake_call_count > QUEUE_SIZE);
+
+	/* Every call rejected for its size is followed by one with at most half the entries */
+	for (size_t i = 0; i + 1 < fake_call_count; i++) {
+		if (fake_calls[i] > fake_max_entries) {
+			zassert_true(fake_calls[i + 1] <= fake_calls[i] / 2, "call %zu", i);
+		}
+	}
+}
+
+ZTEST(telemetry_queue, test_io_error)
+{
+	int64_t first_ts = next_ts;
+
+	/* The first message with more than one entry fails after its first entry */
+	fake_eio_after = 1;
+	zassert_ok(put(QUEUE_SIZE));
+	drain();
+
+	/* Entries sent before the error are removed, the others wait for the retry */
+	zassert_equal(fake_eio_after, SIZE_MAX);
+	zassert_true(fake_sent_count < QUEUE_SIZE);
+	assert_sent(first_ts, fake_sent_count);
+	zassert_equal(thingsboard_telemetry_queue_count(), QUEUE_SIZE - fake_sent_count);
+
+	drain();
+
+	zassert_true(thingsboard_telemetry_queue_is_empty());
+	assert_sent(first_ts, QUEUE_SIZE);
+}
+
+ZTEST(telemetry_queue, test_inactive)
+{
+	fake_active = false;
+	zassert_ok(put(2));
+	drain();
+
+	zassert_equal(fake_call_count, 0);
+	zassert_equal(thingsboard_telemetry_queue_count(), 2);
+}
+
+static int commit_ok(const char *buffer, size_t len)
+{
+	return 0;
+}
+
+static int commit_fail(const char *buffer, size_t len)
+{
+	return -EIO;
+}
+
+ZTEST(telemetry_queue, test_encode_commit)
+{
+	static char buffer[CONFIG_COAP_CLIENT_MESSAGE_SIZE];
+
+	zassert_ok(put(2));
+
+	/* Entries are only removed once they have been committed */
+	zassert_equal(thingsboard_telemetry_queue_encode(buffer, sizeof(buffer), commit_fail),
+		      -EIO);
+	zassert_equal(thingsboard_telemetry_queue_count(), 2);
+
+	int ret = thingsboard_telemetry_queue_encode(buffer, sizeof(buffer), commit_ok);
+
+	zassert_true(ret >= 1 && ret <= 2);
+	zassert_equal(thingsboard_telemetry_queue_count(), 2 - ret);
+}
+
+ZTEST_SUITE(telemetry_queue, NULL, NULL, queue_before, NULL, NULL);